@@ -0,0 +1,160 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the lock-free audio ring buffer. Head and Tail only
+// ever grow (modulo 2^32) and each is written by one side only, so a
+// release store of one and an acquire load of the other is all the
+// synchronisation needed between the producer and the consumer
+
+#include "AudioRing.h"
+#include <stdlib.h>
+#include <string.h>
+
+/****************************************************************************/
+/*** Allocate a ring of at least size samples                             ***/
+/****************************************************************************/
+int AudioRing_Init(AudioRing *R, int size, int target)
+{
+  unsigned n;
+
+  for (n = 64; n < (unsigned)size; n <<= 1);
+  if (!(R->Buf = calloc(n, sizeof(short))))
+    return 0;
+  R->Size = n;
+  R->Target = target < 2 ? 2 : (unsigned)target < n ? (unsigned)target : n;
+  atomic_init(&R->Head, 0);
+  atomic_init(&R->Tail, 0);
+  AudioRing_Clear(R);
+  return 1;
+}
+
+/****************************************************************************/
+/*** Empty the ring                                                       ***/
+/****************************************************************************/
+void AudioRing_Clear(AudioRing *R)
+{
+  atomic_store(&R->Tail, atomic_load(&R->Head));
+  R->Frac = 0;
+  R->Average = R->Target << 8;
+  R->Last = 0;
+  R->Starved = 1;
+}
+
+/****************************************************************************/
+/*** Return the number of samples that can be read                        ***/
+/****************************************************************************/
+int AudioRing_Fill(AudioRing *R)
+{
+  return atomic_load_explicit(&R->Head, memory_order_acquire)
+       - atomic_load_explicit(&R->Tail, memory_order_acquire);
+}
+
+/****************************************************************************/
+/*** Append samples, as far as they fit                                   ***/
+/****************************************************************************/
+int AudioRing_Write(AudioRing *R, const short *buf, int n)
+{
+  unsigned head, tail, pos, part;
+
+  if (!R->Buf) return 0;
+  head = atomic_load_explicit(&R->Head, memory_order_relaxed);
+  tail = atomic_load_explicit(&R->Tail, memory_order_acquire);
+  if ((unsigned)n > R->Size - (head - tail))
+    n = R->Size - (head - tail);
+  pos = head & (R->Size - 1);
+  part = R->Size - pos < (unsigned)n ? R->Size - pos : (unsigned)n;
+  memcpy(R->Buf + pos, buf, part * sizeof(short));
+  memcpy(R->Buf, buf + part, (n - part) * sizeof(short));
+  atomic_store_explicit(&R->Head, head + n, memory_order_release);
+  return n;
+}
+
+/****************************************************************************/
+/*** Take samples as they are                                             ***/
+/****************************************************************************/
+int AudioRing_Read(AudioRing *R, short *buf, int n)
+{
+  unsigned head, tail, pos, part;
+
+  if (!R->Buf) return 0;
+  tail = atomic_load_explicit(&R->Tail, memory_order_relaxed);
+  head = atomic_load_explicit(&R->Head, memory_order_acquire);
+  if ((unsigned)n > head - tail)
+    n = head - tail;
+  pos = tail & (R->Size - 1);
+  part = R->Size - pos < (unsigned)n ? R->Size - pos : (unsigned)n;
+  memcpy(buf, R->Buf + pos, part * sizeof(short));
+  memcpy(buf + part, R->Buf, (n - part) * sizeof(short));
+  atomic_store_explicit(&R->Tail, tail + n, memory_order_release);
+  return n;
+}
+
+/****************************************************************************/
+/*** Produce n samples by linear interpolation, with a step that is a     ***/
+/*** little over or under one sample, depending on the fill level         ***/
+/****************************************************************************/
+void AudioRing_Resample(AudioRing *R, short *buf, int n)
+{
+  unsigned head, tail, mask;
+  int step, starved, a, b, i;
+  long long error;
+
+  if (!R->Buf) {
+    memset(buf, 0, n * sizeof(short));
+    return;
+  }
+  mask = R->Size - 1;
+  tail = atomic_load_explicit(&R->Tail, memory_order_relaxed);
+  head = atomic_load_explicit(&R->Head, memory_order_acquire);
+  // the fill level saws up and down by a block on every write and read,
+  // so the rate follows its average to keep the pitch steady
+  R->Average += ((int)((head - tail) << 8) - R->Average) >> 4;
+  error = R->Average - (int)(R->Target << 8);
+  step = (int)(error * AUDIORING_MAX_ADJUST / (int)(R->Target << 7));
+  if (step > AUDIORING_MAX_ADJUST) step = AUDIORING_MAX_ADJUST;
+  if (step < -AUDIORING_MAX_ADJUST) step = -AUDIORING_MAX_ADJUST;
+  step += 0x10000;
+  // refill up to the target before playing again, or every interrupt
+  // that follows an underrun would run dry as well
+  starved = R->Starved && head - tail < R->Target;
+  for (i = 0; i < n; ++i) {
+    if (starved || head - tail < 2) {
+      starved = 1;
+      buf[i] = R->Last;
+      continue;
+    }
+    a = R->Buf[tail & mask];
+    b = R->Buf[(tail + 1) & mask];
+    buf[i] = R->Last = a + (((b - a) * (int)(R->Frac >> 1)) >> 15);
+    R->Frac += step;
+    tail += R->Frac >> 16;
+    R->Frac &= 0xFFFF;
+  }
+  R->Starved = starved;
+  atomic_store_explicit(&R->Tail, tail, memory_order_release);
+}
+
+/****************************************************************************/
+/*** Free the buffer allocated by AudioRing_Init()                        ***/
+/****************************************************************************/
+void AudioRing_Trash(AudioRing *R)
+{
+  if (R->Buf) free(R->Buf);
+  R->Buf = NULL;
+}
@@ -0,0 +1,86 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains a lock-free single-producer/single-consumer ring
+// buffer for audio samples. The emulation thread writes the samples of
+// every interrupt, the audio thread reads them at the rate of the sound
+// card and stretches or squeezes them slightly to keep the buffer at its
+// target fill level, so the drift between both clocks never crackles
+
+#ifndef _AUDIORING_H
+#define _AUDIORING_H
+
+#include <stdatomic.h>
+
+#define AUDIORING_MAX_ADJUST 328  /* Max rate adjustment, 1/65536 units  */
+
+typedef struct
+{
+  short *Buf;               /* Samples, Size entries                    */
+  unsigned Size;            /* Buffer size, a power of two              */
+  unsigned Target;          /* Fill level aimed at by the consumer      */
+  atomic_uint Head;         /* Write position, set by the producer      */
+  atomic_uint Tail;         /* Read position, set by the consumer       */
+  unsigned Frac;            /* Fractional read position (16 bits)       */
+  int Average;              /* Smoothed fill level (<<8)                */
+  short Last;               /* Last sample output, held on an underrun  */
+  atomic_int Starved;       /* 1 after an underrun, until refilled      */
+} AudioRing;
+
+/****************************************************************************/
+/*** Allocate a ring of at least size samples, which is kept filled up    ***/
+/*** to target samples. Returns 0 in case of a failure                    ***/
+/****************************************************************************/
+int AudioRing_Init(AudioRing *R, int size, int target);
+
+/****************************************************************************/
+/*** Empty the ring. Only call this while nobody reads or writes it       ***/
+/****************************************************************************/
+void AudioRing_Clear(AudioRing *R);
+
+/****************************************************************************/
+/*** Return the number of samples that can be read                        ***/
+/****************************************************************************/
+int AudioRing_Fill(AudioRing *R);
+
+/****************************************************************************/
+/*** Producer: append n samples. Samples that don't fit are dropped.      ***/
+/*** Returns the number of samples written                                ***/
+/****************************************************************************/
+int AudioRing_Write(AudioRing *R, const short *buf, int n);
+
+/****************************************************************************/
+/*** Consumer: take up to n samples as they are. Returns the number of    ***/
+/*** samples read                                                         ***/
+/****************************************************************************/
+int AudioRing_Read(AudioRing *R, short *buf, int n);
+
+/****************************************************************************/
+/*** Consumer: produce exactly n samples, resampled at a rate that pulls  ***/
+/*** the fill level towards the target. An underrun holds the last        ***/
+/*** sample                                                               ***/
+/****************************************************************************/
+void AudioRing_Resample(AudioRing *R, short *buf, int n);
+
+/****************************************************************************/
+/*** Free the buffer allocated by AudioRing_Init()                        ***/
+/****************************************************************************/
+void AudioRing_Trash(AudioRing *R);
+
+#endif /* _AUDIORING_H */
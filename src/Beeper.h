@@ -0,0 +1,56 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the band-limited beeper synthesiser, shared by the
+// front ends. Every write to the sound register adds a band-limited step
+// at its exact position in the audio buffer, so toggles within a sample
+// are not lost and there is no aliasing, even at low sample rates
+
+#ifndef _BEEPER_H
+#define _BEEPER_H
+
+#include "Z80.h"            /* byte, word and dword types    */
+
+#define BEEPER_PHASES 32    /* Sub-sample positions of a step           */
+#define BEEPER_TAPS   16    /* Samples a step is spread over            */
+
+/****************************************************************************/
+/*** Start the beeper with the given number of samples per interrupt.     ***/
+/*** Returns 0 in case of a failure                                       ***/
+/****************************************************************************/
+int Beeper_Init(int samples);
+
+/****************************************************************************/
+/*** Set the speaker level (0 or 1) at the given number of Z80 cycles     ***/
+/*** into an interrupt period of the given length                         ***/
+/****************************************************************************/
+void Beeper_Write(int cycle, int period, int level);
+
+/****************************************************************************/
+/*** Render the samples of the interrupt period that ended, with a peak   ***/
+/*** level of amplitude (at most 8191)                                    ***/
+/****************************************************************************/
+void Beeper_Render(short *buf, int amplitude);
+
+/****************************************************************************/
+/*** Free the buffers allocated by Beeper_Init()                          ***/
+/****************************************************************************/
+void Beeper_Trash(void);
+
+#endif /* _BEEPER_H */
@@ -0,0 +1,178 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the character cell stream writer and reader
+
+#include "CellStream.h"
+#include <stdlib.h>
+#include <string.h>
+
+/****************************************************************************/
+/*** Fill H[] with the header of a cell stream                            ***/
+/****************************************************************************/
+void CellStream_Header(const CellStreamInfo *Info, byte *H)
+{
+  memset(H, 0, CELLSTREAM_HEADER_SIZE);
+  memcpy(H, "M2CS", 4);
+  H[4] = CELLSTREAM_VERSION;
+  H[5] = Info->Columns;
+  H[6] = CELLSTREAM_ROWS;
+  H[8] = Info->RateNum & 0xFF;
+  H[9] = Info->RateNum >> 8;
+  H[10] = Info->RateDen & 0xFF;
+  H[11] = Info->RateDen >> 8;
+  memcpy(H + 16, Info->Palette, sizeof(Info->Palette));
+}
+
+/****************************************************************************/
+/*** Start a cell stream on an open file and write its header             ***/
+/****************************************************************************/
+CellStream *CellStream_Open(FILE *F, const CellStreamInfo *Info)
+{
+  byte H[CELLSTREAM_HEADER_SIZE];
+  CellStream *S;
+  int i;
+
+  if (Info->Columns < 1 || Info->Columns > CELLSTREAM_MAX_COLUMNS)
+    return NULL;
+  CellStream_Header(Info, H);
+  if (F && fwrite(H, sizeof(H), 1, F) != 1)
+    return NULL;
+  if (!(S = malloc(sizeof(CellStream))))
+    return NULL;
+  S->F = F;
+  S->Columns = Info->Columns;
+  S->Count = 0;
+  for (i = 0; i < CELLSTREAM_MAX_CELLS; ++i)
+    S->Cells[i] = -1;
+  return S;
+}
+
+/****************************************************************************/
+/*** Put a character cell in the current frame                            ***/
+/****************************************************************************/
+void CellStream_Put(CellStream *S, int x, int y, int c, int fg, int bg, int si)
+{
+  int k = CELL(c, fg, bg, si);
+  int *P = S->Cells + y * S->Columns + x;
+  byte *B;
+
+  // the decoders put every cell at most once per frame, so the record
+  // of a frame never holds more than CELLSTREAM_MAX_CELLS cells
+  if (*P == k)
+    return;
+  *P = k;
+  B = S->Buf + 2 + 4 * S->Count++;
+  B[0] = x;
+  B[1] = y;
+  B[2] = c;
+  B[3] = fg | (bg << 3) | (si << 6);
+}
+
+/****************************************************************************/
+/*** End the current frame, leaving its record in S->Buf                  ***/
+/****************************************************************************/
+int CellStream_Record(CellStream *S)
+{
+  int n = S->Count;
+  S->Buf[0] = n & 0xFF;
+  S->Buf[1] = n >> 8;
+  S->Count = 0;
+  return 2 + 4 * n;
+}
+
+/****************************************************************************/
+/*** Put a record with all cells put so far in Buf[]                      ***/
+/****************************************************************************/
+int CellStream_KeyFrame(const CellStream *S, byte *Buf)
+{
+  int i, k, n;
+  byte *B = Buf + 2;
+
+  for (i = n = 0; i < S->Columns * CELLSTREAM_ROWS; ++i)
+    if ((k = S->Cells[i]) >= 0)
+    {
+      *B++ = i % S->Columns;
+      *B++ = i / S->Columns;
+      *B++ = CELL_CHAR(k);
+      *B++ = CELL_FG(k) | (CELL_BG(k) << 3) | (CELL_SI(k) << 6);
+      ++n;
+    }
+  Buf[0] = n & 0xFF;
+  Buf[1] = n >> 8;
+  return 2 + 4 * n;
+}
+
+/****************************************************************************/
+/*** End the current frame and write its record in a single write         ***/
+/****************************************************************************/
+int CellStream_EndFrame(CellStream *S)
+{
+  return fwrite(S->Buf, CellStream_Record(S), 1, S->F) == 1;
+}
+
+/****************************************************************************/
+/*** Close the stream and its file, if any                                ***/
+/****************************************************************************/
+void CellStream_Close(CellStream *S)
+{
+  if (S->F) fclose(S->F);
+  free(S);
+}
+
+/****************************************************************************/
+/*** Read the header of a cell stream                                     ***/
+/****************************************************************************/
+int CellStream_ReadHeader(FILE *F, CellStreamInfo *Info)
+{
+  byte H[CELLSTREAM_HEADER_SIZE];
+
+  if (fread(H, sizeof(H), 1, F) != 1 || memcmp(H, "M2CS", 4) ||
+      H[4] != CELLSTREAM_VERSION)
+    return 0;
+  Info->Columns = H[5];
+  Info->Rows = H[6];
+  Info->RateNum = H[8] | (H[9] << 8);
+  Info->RateDen = H[10] | (H[11] << 8);
+  memcpy(Info->Palette, H + 16, sizeof(Info->Palette));
+  return Info->Columns >= 1 && Info->Columns <= CELLSTREAM_MAX_COLUMNS &&
+         Info->Rows == CELLSTREAM_ROWS && Info->RateNum && Info->RateDen;
+}
+
+/****************************************************************************/
+/*** Read the next frame record and apply it to Cells[]                   ***/
+/****************************************************************************/
+int CellStream_ReadFrame(FILE *F, const CellStreamInfo *Info, int *Cells)
+{
+  byte B[4];
+  int n, i;
+
+  if (fread(B, 2, 1, F) != 1)
+    return -1;
+  n = B[0] | (B[1] << 8);
+  for (i = 0; i < n; ++i)
+  {
+    if (fread(B, 4, 1, F) != 1)
+      return -1;
+    if (B[0] < Info->Columns && B[1] < Info->Rows)
+      Cells[B[1] * Info->Columns + B[0]] =
+        CELL(B[2], B[3] & 7, (B[3] >> 3) & 7, B[3] >> 6);
+  }
+  return n;
+}
@@ -0,0 +1,126 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the character cell stream, a compact recording of the
+// characters put on the screen. The stream starts with a 40 byte header:
+//   0  "M2CS"
+//   4  version (1)
+//   5  number of columns (40 or 80)
+//   6  number of rows (24)
+//   7  reserved (0)
+//   8  frame rate numerator (word, LSB first)
+//  10  frame rate denominator (word, LSB first)
+//  12  reserved (0)
+//  16  palette: 8 RGB triplets
+// It is followed by one record per frame: a word (LSB first) with the
+// number of cells that changed since the previous frame and 4 bytes for
+// each of these cells: x, y, character and attributes (fg | bg<<3 | si<<6),
+// with the same meaning as the arguments of PutChar()
+
+#ifndef _CELLSTREAM_H
+#define _CELLSTREAM_H
+
+#include <stdio.h>
+#include "Z80.h"            /* byte, word and dword types    */
+
+#define CELLSTREAM_VERSION     1
+#define CELLSTREAM_HEADER_SIZE 40
+#define CELLSTREAM_ROWS        24
+#define CELLSTREAM_MAX_COLUMNS 80
+#define CELLSTREAM_MAX_CELLS   (CELLSTREAM_MAX_COLUMNS*CELLSTREAM_ROWS)
+
+/* Packed cell: character | fg<<8 | bg<<11 | si<<14 */
+#define CELL(c,fg,bg,si)    ((c)|((fg)<<8)|((bg)<<11)|((si)<<14))
+#define CELL_CHAR(k)        ((k)&0xFF)
+#define CELL_FG(k)          (((k)>>8)&7)
+#define CELL_BG(k)          (((k)>>11)&7)
+#define CELL_SI(k)          (((k)>>14)&3)
+
+typedef struct
+{
+  int Columns;                  /* Number of columns (40 or 80)             */
+  int Rows;                     /* Number of rows                           */
+  int RateNum, RateDen;         /* Frames per second (RateNum/RateDen)      */
+  byte Palette[8*3];            /* RGB colours 0..7                         */
+} CellStreamInfo;
+
+typedef struct
+{
+  FILE *F;                      /* Output stream                            */
+  int Columns;                  /* Number of columns                        */
+  int Count;                    /* Cells changed in the current frame       */
+  int Cells[CELLSTREAM_MAX_CELLS];   /* Last cell written, -1 if none       */
+  byte Buf[2+4*CELLSTREAM_MAX_CELLS]; /* Record of the current frame        */
+} CellStream;
+
+/****************************************************************************/
+/*** Start a cell stream on an open file and write its header. F may be   ***/
+/*** NULL when the records are only taken with CellStream_Record().       ***/
+/*** Returns NULL in case of a failure                                    ***/
+/****************************************************************************/
+CellStream *CellStream_Open(FILE *F, const CellStreamInfo *Info);
+
+/****************************************************************************/
+/*** Fill H[CELLSTREAM_HEADER_SIZE] with the header of a cell stream      ***/
+/****************************************************************************/
+void CellStream_Header(const CellStreamInfo *Info, byte *H);
+
+/****************************************************************************/
+/*** Put a character cell in the current frame. Cells that did not change ***/
+/*** since the previous frame are not written                             ***/
+/****************************************************************************/
+void CellStream_Put(CellStream *S, int x, int y, int c, int fg, int bg, int si);
+
+/****************************************************************************/
+/*** End the current frame. Its record is left in S->Buf and its size is  ***/
+/*** returned                                                             ***/
+/****************************************************************************/
+int CellStream_Record(CellStream *S);
+
+/****************************************************************************/
+/*** Put a record with all cells put so far in Buf (which must be big     ***/
+/*** enough for CELLSTREAM_MAX_CELLS cells), so a reader can start there. ***/
+/*** Returns its size                                                     ***/
+/****************************************************************************/
+int CellStream_KeyFrame(const CellStream *S, byte *Buf);
+
+/****************************************************************************/
+/*** End the current frame and write its record. Returns 0 on a write     ***/
+/*** error                                                                ***/
+/****************************************************************************/
+int CellStream_EndFrame(CellStream *S);
+
+/****************************************************************************/
+/*** Close the stream and its file, if any                                ***/
+/****************************************************************************/
+void CellStream_Close(CellStream *S);
+
+/****************************************************************************/
+/*** Read the header of a cell stream. Returns 0 if it is not valid       ***/
+/****************************************************************************/
+int CellStream_ReadHeader(FILE *F, CellStreamInfo *Info);
+
+/****************************************************************************/
+/*** Read the next frame record and apply it to Cells[] (packed with      ***/
+/*** CELL(), Info->Columns per row). Returns the number of changed cells, ***/
+/*** or -1 at the end of the stream                                       ***/
+/****************************************************************************/
+int CellStream_ReadFrame(FILE *F, const CellStreamInfo *Info, int *Cells);
+
+#endif /* _CELLSTREAM_H */
@@ -0,0 +1,484 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the gzip decompressor (RFC 1951 and RFC 1952). Codes
+// are decoded a bit at a time with canonical Huffman tables, which is
+// plenty fast for cassette images. The CRC-32 and size in the trailer
+// are checked, so a damaged archive is not mistaken for a tape. A file of
+// several members, e.g. made by cat or bgzip, unpacks to all of them
+
+#include "Gzip.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BITS  15            /* Longest Huffman code                     */
+#define MAX_CODES 288           /* Literal/length codes                     */
+#define IN_CHUNK  4096          /* Bytes read from a file at a time         */
+
+typedef struct
+{
+  FILE *F;                      /* File read from or NULL                   */
+  const byte *In;               /* Input bytes                              */
+  long InLen, InPos;            /* Their number and the next one            */
+  byte Buf[IN_CHUNK];           /* Input read from F                        */
+  dword Bits;                   /* Bits read, but not used yet              */
+  int Count;                    /* Number of Bits                           */
+  byte *Out;                    /* Output                                   */
+  long OutLen, OutCap;          /* Output size and bytes allocated          */
+  long Start;                   /* Output of the current member starts here */
+  int Error;                    /* 1 if the input is damaged or cut off     */
+} Inflater;
+
+typedef struct
+{
+  short Count[MAX_BITS+1];      /* Number of codes of each length           */
+  short Symbol[MAX_CODES];      /* Symbols ordered by code                  */
+} Huffman;
+
+static const short LengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const byte LengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const short DistBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+  8193, 12289, 16385, 24577 };
+static const byte DistExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const byte CodeOrder[19] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// The tables below are constant, rather than built on first use, so that
+// several threads can unpack images at the same time. The fixed codes
+// are 8 bits for literals 0-143, 9 bits for 144-255, 7 bits for 256-279
+// and 8 bits for 280-287, and 5 bits for all distances; the symbols are
+// ordered by code length and then by value, as Build() would order them
+static const Huffman FixedLengths = {
+  { 0, 0, 0, 0, 0, 0, 0, 24, 152, 112, 0, 0, 0, 0, 0, 0 },
+  {
+    256, 257, 258, 259, 260, 261, 262, 263, 264, 265, 266, 267, 268, 269, 270, 271,
+    272, 273, 274, 275, 276, 277, 278, 279, 0, 1, 2, 3, 4, 5, 6, 7,
+    8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+    24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+    40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+    56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+    72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87,
+    88, 89, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100, 101, 102, 103,
+    104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119,
+    120, 121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135,
+    136, 137, 138, 139, 140, 141, 142, 143, 280, 281, 282, 283, 284, 285, 286, 287,
+    144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159,
+    160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175,
+    176, 177, 178, 179, 180, 181, 182, 183, 184, 185, 186, 187, 188, 189, 190, 191,
+    192, 193, 194, 195, 196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207,
+    208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218, 219, 220, 221, 222, 223,
+    224, 225, 226, 227, 228, 229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239,
+    240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255 } };
+static const Huffman FixedDists = {
+  { 0, 0, 0, 0, 0, 30 },
+  {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29 } };
+
+// CRC-32 of every byte value, with the polynomial 0xEDB88320
+static const dword CRCTable[256] = {
+  0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
+  0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
+  0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
+  0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+  0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9,
+  0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
+  0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C,
+  0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+  0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
+  0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
+  0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D, 0x76DC4190, 0x01DB7106,
+  0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+  0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D,
+  0x91646C97, 0xE6635C01, 0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
+  0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
+  0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+  0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7,
+  0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
+  0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA,
+  0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+  0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
+  0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
+  0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84,
+  0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+  0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB,
+  0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
+  0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
+  0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+  0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55,
+  0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
+  0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28,
+  0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+  0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
+  0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
+  0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242,
+  0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+  0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69,
+  0x616BFFD3, 0x166CCF45, 0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
+  0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
+  0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+  0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693,
+  0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
+  0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D };
+
+/****************************************************************************/
+/*** Return the next input byte, or 0 and set Error at the end            ***/
+/****************************************************************************/
+static int GetByte(Inflater *I)
+{
+  if (I->InPos == I->InLen) {
+    if (I->F && (I->InLen = fread(I->Buf, 1, IN_CHUNK, I->F)) > 0) {
+      I->In = I->Buf;
+      I->InPos = 0;
+    } else {
+      I->InLen = I->InPos;
+      I->Error = 1;
+      return 0;
+    }
+  }
+  return I->In[I->InPos++];
+}
+
+/****************************************************************************/
+/*** Return the next n bits, least significant first                      ***/
+/****************************************************************************/
+static unsigned GetBits(Inflater *I, int n)
+{
+  unsigned v;
+
+  while (I->Count < n) {
+    I->Bits |= (dword)GetByte(I) << I->Count;
+    I->Count += 8;
+  }
+  v = I->Bits & ((1UL << n) - 1);
+  I->Bits >>= n;
+  I->Count -= n;
+  return v;
+}
+
+/****************************************************************************/
+/*** Append a byte to the output                                          ***/
+/****************************************************************************/
+static int PutByte(Inflater *I, int c)
+{
+  long cap;
+  byte *p;
+
+  if (I->OutLen == I->OutCap) {
+    cap = I->OutCap ? 2 * I->OutCap : 64 * 1024;
+    if (I->OutLen >= GZIP_MAX_SIZE || !(p = realloc(I->Out, cap)))
+      return 0;
+    I->Out = p;
+    I->OutCap = cap;
+  }
+  I->Out[I->OutLen++] = c;
+  return 1;
+}
+
+/****************************************************************************/
+/*** Build a decoding table from n code lengths. Returns 0 if the lengths ***/
+/*** make more codes than fit                                             ***/
+/****************************************************************************/
+static int Build(Huffman *H, const byte *lengths, int n)
+{
+  short offset[MAX_BITS+1];
+  int i, left;
+
+  memset(H->Count, 0, sizeof(H->Count));
+  for (i = 0; i < n; ++i)
+    H->Count[lengths[i]]++;
+  for (left = 1, i = 1; i <= MAX_BITS; ++i) {
+    left = 2 * left - H->Count[i];
+    if (left < 0)
+      return 0;
+  }
+  for (offset[1] = 0, i = 1; i < MAX_BITS; ++i)
+    offset[i + 1] = offset[i] + H->Count[i];
+  for (i = 0; i < n; ++i)
+    if (lengths[i])
+      H->Symbol[offset[lengths[i]]++] = i;
+  return 1;
+}
+
+/****************************************************************************/
+/*** Decode a symbol, or return -1 for a code that isn't in the table     ***/
+/****************************************************************************/
+static int Decode(Inflater *I, const Huffman *H)
+{
+  int len, code = 0, first = 0, index = 0, count;
+
+  for (len = 1; len <= MAX_BITS; ++len) {
+    code |= GetBits(I, 1);
+    count = H->Count[len];
+    if (code - first < count)
+      return H->Symbol[index + code - first];
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+/****************************************************************************/
+/*** Decode a block of compressed data up to its end code                 ***/
+/****************************************************************************/
+static int Codes(Inflater *I, const Huffman *Lengths, const Huffman *Dists)
+{
+  int sym, len, dist;
+
+  for (;;) {
+    sym = Decode(I, Lengths);
+    if (sym < 0 || I->Error)
+      return 0;
+    if (sym < 256) {
+      if (!PutByte(I, sym))
+        return 0;
+    } else if (sym == 256) {
+      return 1;
+    } else {
+      sym -= 257;
+      if (sym >= 29)
+        return 0;
+      len = LengthBase[sym] + GetBits(I, LengthExtra[sym]);
+      sym = Decode(I, Dists);
+      if (sym < 0 || sym >= 30)
+        return 0;
+      dist = DistBase[sym] + GetBits(I, DistExtra[sym]);
+      // members are independent, there is no going back into the last one
+      if (dist > I->OutLen - I->Start)
+        return 0;
+      while (len--)
+        if (!PutByte(I, I->Out[I->OutLen - dist]))
+          return 0;
+    }
+  }
+}
+
+/****************************************************************************/
+/*** Copy a stored block                                                  ***/
+/****************************************************************************/
+static int Stored(Inflater *I)
+{
+  int len;
+
+  // skip to a byte boundary; the bits left are fewer than eight
+  I->Bits = 0;
+  I->Count = 0;
+  len = GetByte(I);
+  len |= GetByte(I) << 8;
+  if ((GetByte(I) ^ 0xFF) != (len & 0xFF) ||
+      (GetByte(I) ^ 0xFF) != (len >> 8))
+    return 0;
+  while (len-- && !I->Error)
+    if (!PutByte(I, GetByte(I)))
+      return 0;
+  return !I->Error;
+}
+
+/****************************************************************************/
+/*** Decode a block with the fixed codes                                  ***/
+/****************************************************************************/
+static int Fixed(Inflater *I)
+{
+  return Codes(I, &FixedLengths, &FixedDists);
+}
+
+/****************************************************************************/
+/*** Decode a block with codes of its own                                 ***/
+/****************************************************************************/
+static int Dynamic(Inflater *I)
+{
+  Huffman Lengths, Dists;
+  byte lengths[MAX_CODES+30];
+  int nlen, ndist, ncode, i, sym, len, repeat;
+
+  nlen = GetBits(I, 5) + 257;
+  ndist = GetBits(I, 5) + 1;
+  ncode = GetBits(I, 4) + 4;
+  if (nlen > MAX_CODES || ndist > 30)
+    return 0;
+  // the code lengths of the code lengths
+  memset(lengths, 0, 19);
+  for (i = 0; i < ncode; ++i)
+    lengths[CodeOrder[i]] = GetBits(I, 3);
+  if (!Build(&Lengths, lengths, 19))
+    return 0;
+  for (i = 0; i < nlen + ndist; ) {
+    sym = Decode(I, &Lengths);
+    if (sym < 0 || I->Error)
+      return 0;
+    if (sym < 16) {
+      lengths[i++] = sym;
+      continue;
+    }
+    len = 0;
+    if (sym == 16) {
+      if (!i)
+        return 0;
+      len = lengths[i - 1];
+      repeat = 3 + GetBits(I, 2);
+    } else if (sym == 17)
+      repeat = 3 + GetBits(I, 3);
+    else
+      repeat = 11 + GetBits(I, 7);
+    if (i + repeat > nlen + ndist)
+      return 0;
+    while (repeat--)
+      lengths[i++] = len;
+  }
+  // there has to be an end code
+  if (!lengths[256])
+    return 0;
+  if (!Build(&Lengths, lengths, nlen) || !Build(&Dists, lengths + nlen, ndist))
+    return 0;
+  return Codes(I, &Lengths, &Dists);
+}
+
+/****************************************************************************/
+/*** Return the CRC-32 of n bytes                                         ***/
+/****************************************************************************/
+static dword CRC32(const byte *p, long n)
+{
+  dword c;
+
+  for (c = 0xFFFFFFFF; n--; ++p)
+    c = CRCTable[(c ^ *p) & 0xFF] ^ (c >> 8);
+  return c ^ 0xFFFFFFFF;
+}
+
+static dword GetDword(Inflater *I)
+{
+  dword v = GetByte(I);
+  v |= GetByte(I) << 8;
+  v |= GetByte(I) << 16;
+  return v | (dword)GetByte(I) << 24;
+}
+
+/****************************************************************************/
+/*** Decompress a gzip member after its ID and method bytes, appending    ***/
+/*** it to the output. Returns 0 if it is damaged or cut off              ***/
+/****************************************************************************/
+static int Member(Inflater *I)
+{
+  int flags, last, ok, n;
+
+  I->Start = I->OutLen;
+  flags = GetByte(I);
+  for (n = 0; n < 6; ++n) GetByte(I); // time, extra flags and OS
+  if (flags & 4) { // extra field
+    n = GetByte(I);
+    for (n |= GetByte(I) << 8; n-- && !I->Error; ) GetByte(I);
+  }
+  if (flags & 8) while (GetByte(I) && !I->Error); // file name
+  if (flags & 16) while (GetByte(I) && !I->Error); // comment
+  if (flags & 2) { GetByte(I); GetByte(I); } // header CRC
+  do {
+    last = GetBits(I, 1);
+    switch (GetBits(I, 2)) {
+    case 0:  ok = Stored(I); break;
+    case 1:  ok = Fixed(I); break;
+    case 2:  ok = Dynamic(I); break;
+    default: ok = 0; break;
+    }
+  } while (ok && !last && !I->Error);
+  // the trailer starts at a byte boundary and covers this member only
+  I->Bits = 0;
+  I->Count = 0;
+  return ok && !I->Error &&
+         GetDword(I) == CRC32(I->Out + I->Start, I->OutLen - I->Start) &&
+         GetDword(I) == (dword)(I->OutLen - I->Start) && !I->Error;
+}
+
+/****************************************************************************/
+/*** Decompress the gzip members up to the end of the input. Anything but ***/
+/*** another member after a member is an error                            ***/
+/****************************************************************************/
+static byte *Inflate(Inflater *I, long *size)
+{
+  int first = 1;
+
+  for (;;) {
+    if (GetByte(I) != 0x1F) {
+      // the input may only end after a member
+      if (I->Error && !first)
+        break;
+      free(I->Out);
+      return NULL;
+    }
+    if (GetByte(I) != 0x8B || GetByte(I) != 8 || !Member(I)) {
+      free(I->Out);
+      return NULL;
+    }
+    first = 0;
+  }
+  *size = I->OutLen;
+  // an empty image still needs a buffer
+  return I->Out ? I->Out : malloc(1);
+}
+
+/****************************************************************************/
+/*** Return 1 if data starts like a gzip file                             ***/
+/****************************************************************************/
+int Gzip_Check(const void *data, long len)
+{
+  const byte *p = data;
+  return len >= 3 && p[0] == 0x1F && p[1] == 0x8B && p[2] == 8;
+}
+
+/****************************************************************************/
+/*** Decompress a gzip file                                               ***/
+/****************************************************************************/
+byte *Gzip_ReadFile(FILE *F, long *size)
+{
+  Inflater *I;
+  byte *p;
+
+  // the inflater holds the input buffer, which is rather big for the stack
+  if (!(I = calloc(1, sizeof(Inflater))))
+    return NULL;
+  I->F = F;
+  p = Inflate(I, size);
+  free(I);
+  return p;
+}
+
+/****************************************************************************/
+/*** Decompress gzip data                                                 ***/
+/****************************************************************************/
+byte *Gzip_ReadData(const void *data, long len, long *size)
+{
+  Inflater *I;
+  byte *p;
+
+  if (!(I = calloc(1, sizeof(Inflater))))
+    return NULL;
+  I->In = data;
+  I->InLen = len;
+  p = Inflate(I, size);
+  free(I);
+  return p;
+}
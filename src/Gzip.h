@@ -0,0 +1,49 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains a gzip decompressor for compressed cassette images.
+// The deflate stream is decoded as it is read, from a file or a buffer,
+// into memory; the whole output is kept, so it is the window as well
+
+#ifndef _GZIP_H
+#define _GZIP_H
+
+#include <stdio.h>
+#include "Z80.h"            /* byte, word and dword types    */
+
+#define GZIP_MAX_SIZE (16*1024*1024) /* Largest output accepted        */
+
+/****************************************************************************/
+/*** Return 1 if the len bytes at data start like a gzip file             ***/
+/****************************************************************************/
+int Gzip_Check(const void *data, long len);
+
+/****************************************************************************/
+/*** Decompress a gzip file from its current position. Returns the data,  ***/
+/*** to be freed by the caller, and its size in *size, or NULL if the     ***/
+/*** file is damaged, too large or can't be read                          ***/
+/****************************************************************************/
+byte *Gzip_ReadFile(FILE *F, long *size);
+
+/****************************************************************************/
+/*** Decompress len bytes of gzip data like Gzip_ReadFile()               ***/
+/****************************************************************************/
+byte *Gzip_ReadData(const void *data, long len, long *size);
+
+#endif /* _GZIP_H */
@@ -43,6 +43,9 @@ static char _ROMName[FILENAME_MAX];
 static char _FontName[FILENAME_MAX];
 static char _TapeName[FILENAME_MAX];
 static char _PrnName[FILENAME_MAX];
+static char _CaptureName[FILENAME_MAX];
+static char _RemoteName[FILENAME_MAX];
+static char _WavName[FILENAME_MAX];
 
 /* Check the command line argument looking for the cartridge or tape file name */
 static void ProcessArgument (int argc,char *argv[]) 
@@ -88,6 +91,9 @@ int M2000_main(int argc,char *argv[])
   ROMName = MakeFullPath(_ROMName, ROMName, ProgramPath);
   FontName = MakeFullPath(_FontName, FontName, ProgramPath);
   PrnName = MakeFullPath(_PrnName, PrnName, DocumentPath);
+  CaptureName = MakeFullPath(_CaptureName, CaptureName, DocumentPath);
+  RemoteName = MakeFullPath(_RemoteName, RemoteName, DocumentPath);
+  WavName = MakeFullPath(_WavName, WavName, DocumentPath);
 
   /* Check for valid variables */
   IFreq = IFreq >= 55 ? 60 : 50; //only support 50Hz and 60Hz
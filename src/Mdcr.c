@@ -0,0 +1,488 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the MDCR modem. Every bit cell of the tape signal has
+// a flux change in its middle, up for a 0 and down for a 1, and one at its
+// start when the bit is the same as the one before. A record starts after
+// a quiet gap and its first flux change is the middle of a 0 bit, the
+// first bit of the sync byte. After that, the time between flux changes
+// tells the bits: half a cell twice for the same bit again, or a whole
+// cell for the other bit, so the polarity of the recording doesn't matter.
+//
+// The flux changes are where the recording crosses halfway between its
+// recent highs and lows, with some hysteresis and a noise gate. A tape
+// head gives a pulse at every flux change instead, which the decoder
+// integrates to get the levels back.
+// Both are tried, and the first block with a good CRC settles which one
+// is used for the rest of the recording.
+//
+// The encoder renders the level of the ROM's write data line. The ROM
+// writes a short record before every block and waits between records;
+// its timing is kept to the Z80 cycle, and a level change that falls
+// inside a sample gives that sample the average level
+
+#include "Mdcr.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK       1024        /* Samples filtered at a time               */
+#define MAX_PENDING 64          /* Blocks kept before choosing a channel    */
+#define MAX_BOX     16          /* Longest moving average                   */
+#define AMPLITUDE   22000       /* Level of the encoded signal              */
+
+/** Channel **************************************************************/
+/** One way of finding the flux changes in the recording, with the     **/
+/** record being read and the blocks read before the choice was made   **/
+/*************************************************************************/
+typedef struct
+{
+  int Integrate;                /* 1: integrate the signal first            */
+  float Sum;                    /* Integrated signal                        */
+  float High, Low;              /* Recent highest and lowest level          */
+  float Peak;                   /* Largest swing over a longer time         */
+  float Last;                   /* Previous sample                          */
+  int Level;                    /* Side of the hysteresis, 0 after a gap    */
+  double Cross;                 /* Last zero crossing, in samples           */
+  double Edge;                  /* Last flux change                         */
+  double Cell;                  /* Samples per bit, as measured             */
+  double Half;                  /* Half a cell waiting for the other half   */
+  int InRecord;                 /* 1: a record is being read                */
+  double Start;                 /* Where the record started                 */
+  float StartPeak;              /* Peak then                                */
+  int Changes;                  /* Flux changes since then                  */
+  int Bit;                      /* Last bit read                            */
+  int Bits, Byte;               /* Bits of the byte being read              */
+  int Len;                      /* Bytes in Buf                             */
+  byte Buf[MDCR_RECORD];        /* Record being read                        */
+  MdcrBlock *Pending;           /* Blocks read before choosing a channel    */
+  int PendingCount;
+} Channel;
+
+struct MdcrDecoder
+{
+  int Rate;                     /* Samples per second                       */
+  double Nominal;               /* Samples per bit at the nominal speed     */
+  float DCRate, EnvRate, PeakDecay, Leak; /* Filter coefficients        */
+  float DC;                     /* Average level of the recording           */
+  short Box[MAX_BOX];           /* Last samples, for the moving average     */
+  int BoxLen, BoxPos;
+  float Sum, Scale;             /* Their sum and what scales it to +-1      */
+  long long Pos;                /* Samples decoded before this chunk        */
+  int Chosen;                   /* Channel in use, or -1 while undecided    */
+  MdcrBlockFn Fn;               /* Called for every block                   */
+  void *Arg;
+  float In[CHUNK];              /* Chunk of samples, DC removed             */
+  Channel C[2];
+};
+
+const byte Mdcr_Marker[MDCR_MARKER] = { MDCR_SYNC, 0, 0, MDCR_SYNC };
+
+struct MdcrEncoder
+{
+  int Rate;                     /* Samples per second                       */
+  long long Cycles;             /* Z80 cycles rendered                      */
+  double Time;                  /* Where that is, in samples                */
+  double Area;                  /* Level so far of the sample being made    */
+  MdcrSampleFn Fn;              /* Called for every chunk of samples        */
+  void *Arg;
+  int Failed;                   /* 1: Fn failed                             */
+  int Len;                      /* Samples in Buf                           */
+  short Buf[CHUNK];
+};
+
+/****************************************************************************/
+/*** Return the CRC of n bytes, as the ROM computes it                    ***/
+/****************************************************************************/
+word Mdcr_CRC(word crc, const byte *p, int n)
+{
+  int i;
+
+  while (n-- > 0)
+    for (crc ^= *p++, i = 0; i < 8; ++i)
+      crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  return crc;
+}
+
+/****************************************************************************/
+/*** Put a block as it is written to tape in record                       ***/
+/****************************************************************************/
+void Mdcr_Record(byte *record, const byte *header, const byte *data)
+{
+  word crc;
+
+  record[0] = MDCR_SYNC;
+  memcpy(record + 1, header, MDCR_HEADER);
+  memcpy(record + 1 + MDCR_HEADER, data, MDCR_DATA);
+  crc = Mdcr_CRC(0, record + 1, MDCR_HEADER + MDCR_DATA);
+  record[MDCR_RECORD - 3] = crc & 0xFF;
+  record[MDCR_RECORD - 2] = crc >> 8;
+  record[MDCR_RECORD - 1] = MDCR_SYNC;
+}
+
+/****************************************************************************/
+/*** Create a decoder                                                     ***/
+/****************************************************************************/
+MdcrDecoder *Mdcr_NewDecoder(int rate, MdcrBlockFn fn, void *arg)
+{
+  MdcrDecoder *D;
+  int i;
+
+  if (rate < 8000 || !(D = calloc(1, sizeof(MdcrDecoder))))
+    return NULL;
+  D->Rate = rate;
+  D->Nominal = (double)rate * MDCR_BIT_CYCLES / MDCR_CLOCK;
+  D->DCRate = 1 / (64 * D->Nominal);
+  D->EnvRate = 1 / (16 * D->Nominal);
+  D->PeakDecay = 1 - 0.5 / rate;
+  D->Leak = 1 - 1 / (2 * D->Nominal);
+  D->BoxLen = D->Nominal / 4 < 2 ? 2 : D->Nominal / 4 > MAX_BOX ? MAX_BOX : (int)(D->Nominal / 4);
+  D->Scale = 1.0f / 32768 / D->BoxLen;
+  D->Chosen = -1;
+  D->Fn = fn;
+  D->Arg = arg;
+  for (i = 0; i < 2; ++i)
+  {
+    D->C[i].Integrate = i;
+    D->C[i].Cell = D->Nominal;
+  }
+  return D;
+}
+
+/****************************************************************************/
+/*** Hand a block read on channel c on to the caller if that channel is   ***/
+/*** chosen. Until then, a good block chooses its channel, and the other  ***/
+/*** blocks are kept                                                      ***/
+/****************************************************************************/
+static void Emit(MdcrDecoder *D, int c, const MdcrBlock *B)
+{
+  Channel *C = &D->C[c];
+  MdcrBlock *P;
+  int i, j;
+
+  if (D->Chosen < 0 && B->Status != MDCR_OK && C->PendingCount < MAX_PENDING)
+  {
+    P = realloc(C->Pending, (C->PendingCount + 1) * sizeof(MdcrBlock));
+    if (P)
+    {
+      C->Pending = P;
+      P[C->PendingCount++] = *B;
+      return;
+    }
+  }
+  if (D->Chosen < 0)
+  {
+    // a good block, or too many bad ones: use this channel from now on
+    D->Chosen = B->Status == MDCR_OK ? c : 0;
+    for (i = 0; i < 2; ++i)
+    {
+      for (j = 0; i == D->Chosen && j < D->C[i].PendingCount; ++j)
+        D->Fn(D->Arg, &D->C[i].Pending[j]);
+      free(D->C[i].Pending);
+      D->C[i].Pending = NULL;
+      D->C[i].PendingCount = 0;
+    }
+  }
+  if (D->Chosen == c)
+    D->Fn(D->Arg, B);
+}
+
+/****************************************************************************/
+/*** End the record being read on channel c and pass it on if it's a      ***/
+/*** block                                                                ***/
+/****************************************************************************/
+static void EndRecord(MdcrDecoder *D, int c)
+{
+  Channel *C = &D->C[c];
+  MdcrBlock B;
+  int n;
+
+  C->InRecord = 0;
+  C->Level = 0;
+  // a short record without a header is noise or the one written before
+  // every block, and a long one without a sync byte is noise too
+  if (C->Len <= MDCR_HEADER || (C->Buf[0] != MDCR_SYNC && C->Len < MDCR_RECORD - 1))
+    return;
+  memset(&B, 0, sizeof(B));
+  n = C->Len - 1;
+  memcpy(B.Header, C->Buf + 1, n < MDCR_HEADER ? n : MDCR_HEADER);
+  n -= MDCR_HEADER;
+  if (n > 0)
+    memcpy(B.Data, C->Buf + 1 + MDCR_HEADER, n < MDCR_DATA ? n : MDCR_DATA);
+  B.Bytes = C->Len;
+  B.Time = C->Start / D->Rate;
+  if (C->Buf[0] != MDCR_SYNC)
+    B.Status = MDCR_NO_SYNC;
+  else if (C->Len < MDCR_RECORD - 1)
+    B.Status = MDCR_SHORT;
+  else if (Mdcr_CRC(0, C->Buf + 1, MDCR_HEADER + MDCR_DATA + 2))
+    B.Status = MDCR_BAD_CRC;
+  else
+    B.Status = MDCR_OK;
+  Emit(D, c, &B);
+}
+
+/****************************************************************************/
+/*** Add a bit to the record, least significant bit first                 ***/
+/****************************************************************************/
+static void PutBit(Channel *C, int bit)
+{
+  C->Bit = bit;
+  C->Byte |= bit << C->Bits;
+  if (++C->Bits == 8)
+  {
+    if (C->Len < MDCR_RECORD)
+      C->Buf[C->Len++] = C->Byte;
+    C->Bits = C->Byte = 0;
+  }
+}
+
+/****************************************************************************/
+/*** Read the bits from a flux change at time t                           ***/
+/****************************************************************************/
+static void FluxChange(MdcrDecoder *D, Channel *C, double t)
+{
+  double dt, cell, gain;
+
+  if (!C->InRecord)
+  {
+    // the middle of the first bit of the sync byte
+    C->InRecord = 1;
+    C->Start = C->Edge = t;
+    C->StartPeak = C->Peak;
+    C->Changes = C->Len = C->Bits = C->Byte = 0;
+    C->Half = 0;
+    PutBit(C, 0);
+    return;
+  }
+  dt = t - C->Edge;
+  C->Edge = t;
+  cell = 0;
+  if (dt < 0.75 * C->Cell)
+  {
+    // half a cell: the same bit again once the other half follows
+    if (C->Half == 0)
+    {
+      C->Half = dt;
+      return;
+    }
+    cell = C->Half + dt;
+    PutBit(C, C->Bit);
+  }
+  else
+  {
+    // a whole cell: the other bit. A lone half cell before it means a
+    // flux change was missed or made up, which the CRC will tell
+    cell = dt;
+    PutBit(C, !C->Bit);
+  }
+  C->Half = 0;
+  // follow the speed of the tape, quickly on the sync byte
+  gain = ++C->Changes < 8 ? 0.25 : 0.0625;
+  C->Cell += (cell - C->Cell) * gain;
+  if (C->Cell < 0.7 * D->Nominal)
+    C->Cell = 0.7 * D->Nominal;
+  if (C->Cell > 1.4 * D->Nominal)
+    C->Cell = 1.4 * D->Nominal;
+}
+
+/****************************************************************************/
+/*** Find the flux changes in the chunk of n samples on channel c         ***/
+/****************************************************************************/
+static void Detect(MdcrDecoder *D, int c, int n)
+{
+  Channel *C = &D->C[c];
+  float x, mid, swing;
+  double t;
+  int i;
+
+  for (i = 0; i < n; ++i)
+  {
+    x = D->In[i];
+    if (C->Integrate)
+      x = C->Sum = C->Sum * D->Leak + x;
+    // slice halfway between the recent highs and lows, which drift
+    // towards each other in the gaps
+    mid = (C->High + C->Low) / 2;
+    C->High = x > C->High ? x : C->High + (mid - C->High) * D->EnvRate;
+    C->Low = x < C->Low ? x : C->Low + (mid - C->Low) * D->EnvRate;
+    swing = C->High - C->Low;
+    C->Peak = swing > C->Peak ? swing : C->Peak * D->PeakDecay;
+    // a record started on noise just before a louder signal is dropped,
+    // so the record starts again on its first flux change
+    if (C->InRecord && C->Len < 2 && C->Peak > 2 * C->StartPeak)
+      C->InRecord = C->Level = 0;
+    x -= mid;
+    t = (double)(D->Pos + i);
+    if ((x < 0) != (C->Last < 0) && x != C->Last)
+      C->Cross = t - x / (x - C->Last);
+    C->Last = x;
+    // a change only counts when the signal clears the hysteresis and
+    // stands out from the noise in the gaps
+    swing = swing < 0.5f * C->Peak || swing < 0.002f ? 1e9f : swing / 8;
+    if (x > swing ? C->Level <= 0 : x < -swing && C->Level >= 0)
+    {
+      // after a gap, the first change may go either way
+      C->Level = x < 0 ? -1 : 1;
+      FluxChange(D, C, t - C->Cross < C->Cell ? C->Cross : t);
+    }
+    else if (C->InRecord && t - C->Edge > 2.5 * C->Cell)
+      EndRecord(D, c);
+  }
+}
+
+/****************************************************************************/
+/*** Decode n samples                                                     ***/
+/****************************************************************************/
+void Mdcr_Decode(MdcrDecoder *D, const short *samples, int n)
+{
+  float dc;
+  int i, j, m;
+
+  for (; n > 0; samples += m, n -= m, D->Pos += m)
+  {
+    m = n < CHUNK ? n : CHUNK;
+    // take out the DC and the hiss above the tape signal, by averaging
+    // over a quarter of a bit
+    for (i = 0, dc = D->DC; i < m; ++i)
+    {
+      D->Sum += samples[i] - D->Box[D->BoxPos];
+      D->Box[D->BoxPos] = samples[i];
+      D->BoxPos = D->BoxPos + 1 < D->BoxLen ? D->BoxPos + 1 : 0;
+      dc += (D->Sum - dc) * D->DCRate;
+      D->In[i] = (D->Sum - dc) * D->Scale;
+    }
+    D->DC = dc;
+    for (j = 0; j < 2; ++j)
+      if (D->Chosen < 0 || D->Chosen == j)
+        Detect(D, j, m);
+  }
+}
+
+/****************************************************************************/
+/*** End the last record and free the decoder                             ***/
+/****************************************************************************/
+void Mdcr_CloseDecoder(MdcrDecoder *D)
+{
+  int i;
+
+  for (i = 0; i < 2; ++i)
+    if (D->C[i].InRecord && (D->Chosen < 0 || D->Chosen == i))
+      EndRecord(D, i);
+  // without a single good block, use the channel that found the most
+  if (D->Chosen < 0)
+  {
+    D->Chosen = D->C[1].PendingCount > D->C[0].PendingCount;
+    for (i = 0; i < D->C[D->Chosen].PendingCount; ++i)
+      D->Fn(D->Arg, &D->C[D->Chosen].Pending[i]);
+  }
+  for (i = 0; i < 2; ++i)
+    free(D->C[i].Pending);
+  free(D);
+}
+
+/****************************************************************************/
+/*** Pass on the samples made so far                                      ***/
+/****************************************************************************/
+static void Flush(MdcrEncoder *E)
+{
+  if (E->Len && !E->Failed && !E->Fn(E->Arg, E->Buf, E->Len))
+    E->Failed = 1;
+  E->Len = 0;
+}
+
+/****************************************************************************/
+/*** Hold the write data line at level (1 or -1) for the given number of  ***/
+/*** Z80 cycles                                                           ***/
+/****************************************************************************/
+static void Hold(MdcrEncoder *E, int level, long cycles)
+{
+  double end, next;
+
+  E->Cycles += cycles;
+  end = (double)E->Cycles * E->Rate / MDCR_CLOCK;
+  for (next = (long long)E->Time + 1; next <= end; E->Time = next++)
+  {
+    E->Buf[E->Len++] = (short)((E->Area + (next - E->Time) * level) * AMPLITUDE);
+    E->Area = 0;
+    if (E->Len == CHUNK)
+      Flush(E);
+  }
+  E->Area += (end - E->Time) * level;
+  E->Time = end;
+}
+
+/****************************************************************************/
+/*** Render n bytes as one record, followed by a gap of ms milliseconds   ***/
+/****************************************************************************/
+static void Record(MdcrEncoder *E, const byte *p, int n, int ms)
+{
+  int i, bit;
+
+  for (; n > 0; --n, ++p)
+    for (i = 0; i < 8; ++i)
+    {
+      bit = (*p >> i) & 1;
+      Hold(E, bit ? 1 : -1, MDCR_BIT_CYCLES / 2);
+      Hold(E, bit ? -1 : 1, MDCR_BIT_CYCLES - MDCR_BIT_CYCLES / 2);
+    }
+  Hold(E, -1, (long)ms * (MDCR_CLOCK / 1000));
+}
+
+/****************************************************************************/
+/*** Create an encoder                                                    ***/
+/****************************************************************************/
+MdcrEncoder *Mdcr_NewEncoder(int rate, MdcrSampleFn fn, void *arg)
+{
+  MdcrEncoder *E;
+
+  if (rate < MDCR_RATE || !(E = calloc(1, sizeof(MdcrEncoder))))
+    return NULL;
+  E->Rate = rate;
+  E->Fn = fn;
+  E->Arg = arg;
+  Hold(E, -1, (long)MDCR_LEADER * (MDCR_CLOCK / 1000));
+  return E;
+}
+
+/****************************************************************************/
+/*** Render a block                                                       ***/
+/****************************************************************************/
+int Mdcr_Encode(MdcrEncoder *E, const byte *header, const byte *data)
+{
+  byte record[MDCR_RECORD];
+
+  Mdcr_Record(record, header, data);
+  Record(E, Mdcr_Marker, MDCR_MARKER, MDCR_MARKER_GAP);
+  Record(E, record, MDCR_RECORD, MDCR_BLOCK_GAP);
+  return !E->Failed;
+}
+
+/****************************************************************************/
+/*** End the recording and free the encoder                               ***/
+/****************************************************************************/
+int Mdcr_CloseEncoder(MdcrEncoder *E)
+{
+  int ok;
+
+  Hold(E, -1, (long)MDCR_LEADER * (MDCR_CLOCK / 1000));
+  Flush(E);
+  ok = !E->Failed;
+  free(E);
+  return ok;
+}
@@ -0,0 +1,114 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the modem for the tape signal of the P2000's mini
+// digital cassette recorder (MDCR). The monitor ROM writes a block as a
+// phase encoded bit stream of about 6000 bits per second: a sync byte,
+// the 32 byte header, 1 KB of data, a CRC and another sync byte. The
+// decoder turns a recording of that signal back into blocks, and the
+// encoder renders blocks as the signal the ROM writes. The emulator
+// plays the same records to programs that read the tape port themselves
+
+#ifndef _MDCR_H
+#define _MDCR_H
+
+#include "Z80.h"            /* byte, word and dword types    */
+
+#define MDCR_CLOCK      2500000 /* Z80 clock of the P2000              */
+#define MDCR_BIT_CYCLES 418     /* Z80 cycles per bit, in the ROM      */
+#define MDCR_SYNC       0xAA    /* First and last byte of a record     */
+#define MDCR_HEADER     32      /* Header bytes of a block             */
+#define MDCR_DATA       1024    /* Data bytes of a block               */
+#define MDCR_RECORD     (1+MDCR_HEADER+MDCR_DATA+2+1) /* Bytes on tape */
+#define MDCR_MARKER     4       /* Bytes of the record before a block  */
+#define MDCR_MARKER_GAP 85      /* Milliseconds between the two        */
+#define MDCR_BLOCK_GAP  675     /* Milliseconds after a block          */
+#define MDCR_LEADER     1000    /* Milliseconds before the first block */
+#define MDCR_RATE       44100   /* Lowest sample rate that round-trips */
+
+extern const byte Mdcr_Marker[MDCR_MARKER]; /* Record before a block  */
+
+/** MdcrBlock ************************************************************/
+/** A block read from the tape and how well it was read. Bytes that    **/
+/** weren't on the tape are zero                                        **/
+/*************************************************************************/
+enum { MDCR_OK, MDCR_BAD_CRC, MDCR_SHORT, MDCR_NO_SYNC };
+typedef struct
+{
+  byte Header[MDCR_HEADER];     /* P2000 header, as in a .cas block         */
+  byte Data[MDCR_DATA];         /* Block data                               */
+  int Status;                   /* MDCR_OK or what went wrong               */
+  int Bytes;                    /* Bytes read, MDCR_RECORD if complete      */
+  double Time;                  /* Where the block starts, in seconds       */
+} MdcrBlock;
+
+typedef struct MdcrDecoder MdcrDecoder;
+typedef void (*MdcrBlockFn)(void *arg, const MdcrBlock *B);
+typedef struct MdcrEncoder MdcrEncoder;
+typedef int (*MdcrSampleFn)(void *arg, const short *samples, int n);
+
+/****************************************************************************/
+/*** Return the CRC of n bytes, as the ROM computes it. Starting from 0,  ***/
+/*** the CRC of a block followed by its CRC, low byte first, is 0         ***/
+/****************************************************************************/
+word Mdcr_CRC(word crc, const byte *p, int n);
+
+/****************************************************************************/
+/*** Put a block as it is written to tape in record, MDCR_RECORD bytes    ***/
+/****************************************************************************/
+void Mdcr_Record(byte *record, const byte *header, const byte *data);
+
+/****************************************************************************/
+/*** Create a decoder for a recording with the given sample rate. Every   ***/
+/*** block found is passed to fn. Returns NULL in case of a failure       ***/
+/****************************************************************************/
+MdcrDecoder *Mdcr_NewDecoder(int rate, MdcrBlockFn fn, void *arg);
+
+/****************************************************************************/
+/*** Decode the next n samples of the recording                           ***/
+/****************************************************************************/
+void Mdcr_Decode(MdcrDecoder *D, const short *samples, int n);
+
+/****************************************************************************/
+/*** Pass on the block still being read at the end of the recording and   ***/
+/*** free the decoder                                                     ***/
+/****************************************************************************/
+void Mdcr_CloseDecoder(MdcrDecoder *D);
+
+/****************************************************************************/
+/*** Create an encoder with the given sample rate, at least MDCR_RATE: a  ***/
+/*** half bit is only 84us, and lower rates lose blocks. The samples are  ***/
+/*** passed to fn a chunk at a time; fn returns 0 when it fails. Returns  ***/
+/*** NULL in case of a failure                                            ***/
+/****************************************************************************/
+MdcrEncoder *Mdcr_NewEncoder(int rate, MdcrSampleFn fn, void *arg);
+
+/****************************************************************************/
+/*** Render a block the way the ROM writes it, with the gaps around it.   ***/
+/*** Returns 0 if fn failed                                               ***/
+/****************************************************************************/
+int Mdcr_Encode(MdcrEncoder *E, const byte *header, const byte *data);
+
+/****************************************************************************/
+/*** End the recording with a gap, pass on the last samples and free the  ***/
+/*** encoder. Returns 0 if fn failed                                      ***/
+/****************************************************************************/
+int Mdcr_CloseEncoder(MdcrEncoder *E);
+
+#endif /* _MDCR_H */
@@ -20,6 +20,13 @@
 // This file contains the P2000 hardware emulation code
 
 #include "P2000.h"
+#include "CellStream.h"
+#include "Remote.h"
+#include "Beeper.h"
+#include "SAA5050.h"
+#include "Tape.h"
+#include "Mdcr.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -27,9 +34,12 @@
 #include <time.h>
 #include <unistd.h>
 
-#define HEADER_SIZE 256 // .cas files uses 256 byte block-headers, while actual P2000T uses 32 byte block-headers
-#define HEADER_OFFSET 48 // actual 32 bytes of header data starts at offset 48 in the 256 byte .cas block-header
+#define HEADER_SIZE TAPE_HEADER_SIZE // .cas files uses 256 byte block-headers, while actual P2000T uses 32 byte block-headers
+#define HEADER_OFFSET TAPE_HEADER_OFFSET // actual 32 bytes of header data starts at offset 48 in the 256 byte .cas block-header
 #define SPACE 32 // space character
+#define RASTER_LINES (IFreq == 60 ? 262 : 312) // scanlines per frame
+#define RASTER_TOP ((RASTER_LINES - 240) / 2) // first scanline of row 0
+#define VRAM_PAGES (P2000Model == P2000_M ? 0x1000 : 0x0800) // mapped VRAM
 
 byte Verbose     = 0;
 const char *ROMName    = "P2000ROM.bin";
@@ -37,16 +47,25 @@ const char *CartName   = "BASIC.bin";
 const char *FontName   = "Default.fnt";
 const char *TapeName   = "Default.cas";
 const char *PrnName    = "Printer.out";
+const char *CaptureName = NULL;
+const char *RemoteName  = NULL;
+const char *WavName     = NULL;
+const char *TapeOverlayName = NULL;
 FILE *PrnStream  = NULL;
-FILE *TapeStream = NULL;
+Tape *TapeImage  = NULL;
 int TapeProtect  = 0;
 int UPeriod      = 1;
 int IFreq        = 50;
 int Sync         = 1;
 int CpuSpeed     = 100;
+int RasterScreen = 1;
+int TapeLoadDelay = 10;
+int TapeTurbo    = 1;
+int TapeStreaming = 0;
 int TapeBootEnabled = 1;
 int PrnType      = 0;
 int RAMSizeKb    = 32;
+int P2000Model   = P2000_T;
 int Z80_IRQ      = Z80_IGNORE_INT;
 int ColdBoot     = 1;
 int NMI          = 0;
@@ -78,6 +97,228 @@ static void Z80_WRWORD (dword a,unsigned v)
  Z80_WRMEM ((a+1)&65535,v>>8);
 }
 
+// video snapshot passed to the front end, which also holds the log of
+// writes to video RAM and the scroll register during the current frame
+static VideoState Video;
+static int VideoWriteCount = 0; // can exceed VIDEO_WRITES on overflow
+static byte FrameVRAM[0x1000]; // VRAM at the start of the current frame
+static byte FrameScrollReg;
+static CellStream *Capture = NULL; // where drawn screens are recorded to
+static int Remote = 0; // 1 if drawn screens are sent to remote viewers
+
+// tape read in progress: blocks left to read, where they go in memory and
+// the loading picture being shown, with its next slice and when it's due
+static int LoadBlocks = 0, LoadAddr = 0;
+static int LoadPicture = 0, LoadPos = 0, LoadLength = 0;
+static unsigned LoadTime = 0;
+static byte LoadBuf[TAPE_BLOCK_SIZE];
+static unsigned Interrupts = 0; // interrupts emulated so far
+
+// tape signal for loaders that read the cassette port themselves: the
+// block it is of, how far the tape has moved into it in Z80 cycles and
+// when that was, the last bit passed, the polls that saw no change and
+// the port bits they saw, whether it was read since the last interrupt,
+// and the block as it is on tape
+static Tape *SignalTape = NULL;
+static long SignalPos = -1;
+static long long SignalTime = 0, SignalNow = 0;
+static int SignalBit = -1, SignalPolls = 0, SignalEnd = 1, SignalPolled = 0;
+static byte SignalLast = 0;
+static byte SignalRecord[MDCR_RECORD];
+
+/****************************************************************************/
+/*** Return the first character row that can show a write done now        ***/
+/****************************************************************************/
+static byte RasterRow (void)
+{
+ int line=(Z80_IPeriod-Z80_ICount)*RASTER_LINES/Z80_IPeriod-RASTER_TOP;
+ if (line<0) return 0;
+ line=line/10+1; // the row being displayed already latched its data
+ return line>24 ? 24:line;
+}
+
+/****************************************************************************/
+/*** Log a video write, so the screen refresh can replay it per row       ***/
+/****************************************************************************/
+static void LogVideoWrite (word a, byte v)
+{
+ VideoWrite *W;
+ if (VideoWriteCount<VIDEO_WRITES)
+ {
+  W=&Video.Write[VideoWriteCount];
+  W->Addr=a;
+  W->Value=v;
+  W->Row=RasterRow();
+ }
+ VideoWriteCount++;
+}
+
+/****************************************************************************/
+/*** Write to a page without a write pointer. With RasterScreen set this  ***/
+/*** is the case for the video RAM pages                                  ***/
+/****************************************************************************/
+void Z80_WrPage (dword a,byte v)
+{
+ if (a>=0x5000 && a<0x5000+VRAM_PAGES)
+ {
+  VRAM[a-0x5000]=v;
+  LogVideoWrite (a-0x5000,v);
+ }
+}
+
+/****************************************************************************/
+/*** Return the number of Z80 cycles emulated so far                      ***/
+/****************************************************************************/
+static long long Cycles (void)
+{
+ return (long long)Interrupts*Z80_IPeriod+Z80_IPeriod-Z80_ICount;
+}
+
+/****************************************************************************/
+/*** The signal of a block: a gap, the short record written before every  ***/
+/*** block, another gap and the block itself, one bit every               ***/
+/*** MDCR_BIT_CYCLES. The first block follows the leader of the tape      ***/
+/****************************************************************************/
+#define MARKER_BITS (MDCR_MARKER*8)
+#define RECORD_BITS (MDCR_RECORD*8)
+#define SIGNAL_BITS (MARKER_BITS+RECORD_BITS)
+#define MS(ms) ((long long)(ms)*(MDCR_CLOCK/1000))
+static long long BitStart (int bit)
+{
+ long long t=(long long)bit*MDCR_BIT_CYCLES;
+ t+=MS(SignalPos? MDCR_BLOCK_GAP:MDCR_LEADER);
+ return bit<MARKER_BITS? t:t+MS(MDCR_MARKER_GAP);
+}
+
+/* The block takes the time up to the start of the bit after its last one */
+#define SIGNAL_LENGTH BitStart(SIGNAL_BITS)
+
+/* Return the last bit started at time t, or -1 */
+static int BitAt (long long t)
+{
+ long long m=t-BitStart(0);
+ long long r=t-BitStart(MARKER_BITS);
+ if (m<0) return -1;
+ if (r<0) return m/MDCR_BIT_CYCLES<MARKER_BITS? (int)(m/MDCR_BIT_CYCLES):MARKER_BITS-1;
+ r=MARKER_BITS+r/MDCR_BIT_CYCLES;
+ return r<SIGNAL_BITS? (int)r:SIGNAL_BITS-1;
+}
+
+/* Return the read data at time t: the bit, then its inverse, low in gaps */
+static int SignalLevel (long long t)
+{
+ int bit=BitAt (t),v;
+ if (bit<0) return 0;
+ t-=BitStart (bit);
+ if (t>=MDCR_BIT_CYCLES) return 0;
+ if (bit<MARKER_BITS)
+  v=(Mdcr_Marker[bit>>3]>>(bit&7))&1;
+ else
+  v=(SignalRecord[(bit-MARKER_BITS)>>3]>>((bit-MARKER_BITS)&7))&1;
+ return t*2<MDCR_BIT_CYCLES? v:!v;
+}
+
+/* Return the time of the next change of the read data within a record, */
+/* or -1 if a gap follows                                               */
+static long long NextEdge (long long t)
+{
+ int bit=BitAt (t);
+ long long start;
+ if (bit<0) return -1;
+ start=BitStart (bit);
+ if (t-start>=MDCR_BIT_CYCLES) return -1;
+ if ((t-start)*2<MDCR_BIT_CYCLES) return start+MDCR_BIT_CYCLES/2;
+ if (bit==MARKER_BITS-1 || bit==SIGNAL_BITS-1) return -1;
+ return start+MDCR_BIT_CYCLES;
+}
+
+/****************************************************************************/
+/*** Start the signal of the block at the tape position                   ***/
+/****************************************************************************/
+static void StartSignal (void)
+{
+ const byte *block;
+ SignalTape=TapeImage;
+ SignalPos=TapeImage->Pos;
+ SignalTime=0;
+ SignalBit=-1;
+ SignalPolls=0;
+ block=Tape_Read (TapeImage,TAPE_BLOCK_SIZE);
+ SignalEnd=!block;
+ if (block)
+  Mdcr_Record (SignalRecord,block+HEADER_OFFSET,block+HEADER_SIZE);
+ Tape_Seek (TapeImage,SignalPos);
+}
+
+/****************************************************************************/
+/*** Move the tape for the cycles since it last moved. It runs while the  ***/
+/*** motor is on and nothing is written, forward or in reverse, and stops ***/
+/*** at either end. The last block is followed by as much blank tape as   ***/
+/*** the first one                                                        ***/
+/****************************************************************************/
+static void MoveTape (void)
+{
+ long long now=Cycles (),t;
+ if (now<SignalNow) SignalNow=now;   /* the CPU speed changed */
+ if (SignalTape!=TapeImage || SignalPos!=TapeImage->Pos)
+  StartSignal ();
+ else if ((OutputReg&0x0E)==0x08)
+  SignalTime+=now-SignalNow;
+ else if ((OutputReg&0x0E)==0x04)
+  SignalTime-=now-SignalNow;
+ SignalNow=now;
+ while (!SignalEnd && SignalTime>=SIGNAL_LENGTH)
+ {
+  t=SignalTime-SIGNAL_LENGTH;
+  if (!Tape_Seek (TapeImage,SignalPos+TAPE_BLOCK_SIZE)) break;
+  StartSignal ();
+  SignalTime=t;
+ }
+ if (SignalEnd && SignalTime>MS(MDCR_LEADER)) SignalTime=MS(MDCR_LEADER);
+ while (SignalTime<0)
+ {
+  t=SignalTime;
+  if (!SignalPos || !Tape_Seek (TapeImage,SignalPos-TAPE_BLOCK_SIZE))
+  {
+   SignalTime=0;
+   break;
+  }
+  StartSignal ();
+  SignalTime=t+SIGNAL_LENGTH;
+ }
+}
+
+/****************************************************************************/
+/*** Return the cassette port bits of the tape signal: the read clock,    ***/
+/*** which toggles for every bit, the read data and the end of tape. In   ***/
+/*** turbo mode, a loader polling for the next change gets it right away  ***/
+/****************************************************************************/
+static byte TapeSignal (byte status)
+{
+ long long t;
+ int bit;
+ MoveTape ();
+ SignalPolled=1;
+ status|=0x20;
+ if (SignalEnd? SignalTime>=MS(MDCR_LEADER):
+                OutputReg&0x04 && !SignalPos && !SignalTime)
+  return status&0x5F;          /* at either end of the tape */
+ if (SignalEnd) return status&0x7F;    /* blank tape after the last block */
+ if (TapeTurbo && (OutputReg&0x04)==0 && ++SignalPolls>1 &&
+     (t=NextEdge (SignalTime))>=0)
+  SignalTime=t;
+ bit=BitAt (SignalTime);
+ if (bit!=SignalBit)
+ {
+  if ((bit-SignalBit)&1) status^=0x40;
+  SignalBit=bit;
+ }
+ if (SignalLevel (SignalTime)) status|=0x80; else status&=0x7F;
+ if ((status^SignalLast)&0xC0) SignalPolls=0;
+ SignalLast=status;
+ return status;
+}
+
 /****************************************************************************/
 /*** Write a value to given I/O port                                      ***/
 /****************************************************************************/
@@ -89,22 +330,26 @@ void Z80_Out (byte Port, byte Value)
   case 0:       /* Read the key-matrix */
    return;
   case 1:       /* Output to cassette/printer */
+   if (TapeImage) MoveTape ();
+   else SignalTape=NULL;
    OutputReg=Value;
    return;
   case 2:       /* Input from cassette/printer */
    return;
   case 3:       /* Scroll Register (T-version only) */
    ScrollReg=Value;
+   if (RasterScreen) LogVideoWrite (VIDEO_SCROLL,Value);
    return;
   case 4:       /* Reserved for I/O cartridge */
    break;
   case 5:       /* Beeper */
    SoundReg=Value;
-   Sound (Value&1);
+   Beeper_Write (Z80_IPeriod-Z80_ICount,Z80_IPeriod,Value&1);
    return;
   case 6:       /* Reserved for I/O cartridge */
    break;
   case 7:       /* DISAS (M-version only) */
+   if (P2000Model==P2000_M) DISAReg=Value;
    return;
  }
  switch (Port)
@@ -154,9 +399,12 @@ byte Z80_In (byte Port)
   case 2:       /* Input from cassette/printer */
   {
    static int inputstatus=0;
-   inputstatus|=0xBF;
-   inputstatus^=0x40;           /* toggle input clock */
-   if (TapeStream) inputstatus&=0xEF;
+   /* a moving tape gives its signal, else the input clock just toggles */
+   if (TapeImage && (OutputReg&0x0C) && !(OutputReg&0x02))
+    inputstatus=TapeSignal (inputstatus|0x1F);
+   else
+    inputstatus=(inputstatus|0xBF)^0x40;
+   if (TapeImage) inputstatus&=0xEF;
    if (!TapeProtect) inputstatus&=0xF7;
    if (PrnName) inputstatus&=0xFD;
    if (PrnType) inputstatus&=0xFB;
@@ -232,12 +480,13 @@ int InitRAM()
 }
 
 /******************************************************************************/
-/*** Allocate memory, load ROM images, initialise mapper, VDP and CPU and   ***/
-/*** the emulation. This function returns 0 in case of a failure            ***/
+/*** Allocate memory, load ROM images, initialise mapper, VDP and CPU and ***/
+/*** the emulation. This function returns 0 in case of a failure          ***/
 /******************************************************************************/
 word Exit_PC;
 int InitP2000 (byte* monitor_rom, byte *cartridge_rom)
 {
+  CellStreamInfo Info;
   FILE *f;
   int i,j;
   
@@ -264,11 +513,35 @@ int InitP2000 (byte* monitor_rom, byte *cartridge_rom)
    ReadPage[i>>8]=ROM+i;
    WritePage[i>>8]=NoRAMWrite;
   }
-  for (i=0x0000;i<0x0800;i+=256)
-    ReadPage[(i+0x5000)>>8]=WritePage[(i+0x5000)>>8]=VRAM+i;
+  // with RasterScreen, video RAM writes go through Z80_WrPage()
+  for (i=0x0000;i<VRAM_PAGES;i+=256)
+  {
+    ReadPage[(i+0x5000)>>8]=VRAM+i;
+    WritePage[(i+0x5000)>>8]=RasterScreen ? NULL : VRAM+i;
+  }
 
   if (!InitRAM()) return 0;
 
+  Info.Columns = P2000_COLUMNS;
+  Info.Rows = 24;
+  Info.RateNum = IFreq;
+  Info.RateDen = UPeriod;
+  memcpy (Info.Palette,SAA5050_Palette,sizeof(Info.Palette));
+  if (CaptureName)
+  {
+    if (Verbose) printf ("Opening capture stream %s... ",CaptureName);
+    f = fopen (CaptureName,"wb");
+    Capture = f ? CellStream_Open (f,&Info) : NULL;
+    if (!Capture && f) fclose (f);
+    if (Verbose) puts (Capture? "OK":"FAILED");
+  }
+  if (RemoteName)
+  {
+    if (Verbose) printf ("Opening remote display socket %s... ",RemoteName);
+    Remote = Remote_Open (RemoteName,&Info);
+    if (Verbose) puts (Remote? "OK":"FAILED");
+  }
+
   if (monitor_rom)
     memcpy (ROM,monitor_rom,0x1000);
   else
@@ -335,7 +608,12 @@ int StartP2000 (void)
 /****************************************************************************/
 void TrashP2000 (void)
 {
- if (TapeStream) fclose (TapeStream);
+ if (Capture) CellStream_Close (Capture);
+ Capture = NULL;
+ if (Remote) Remote_Close ();
+ Remote = 0;
+ if (TapeImage) Tape_Close (TapeImage);
+ TapeImage = NULL;
  if (PrnStream) fclose (PrnStream);
  if (ROM) free (ROM);
  if (VRAM) free (VRAM);
@@ -347,35 +625,101 @@ void TrashP2000 (void)
 /****************************************************************************/
 void RemoveCassette()
 {
+  int ok = 1;
+
   if (Verbose) printf ("Removing tape... ");
-  if (TapeStream) fclose (TapeStream);
-  TapeStream = NULL;
+  if (TapeImage) {
+    ok = Tape_Flush (TapeImage,1); // wait for the writes behind
+    Tape_Close (TapeImage);
+  }
+  TapeImage = NULL;
+  SignalTape = NULL;
   TapeName = NULL;
   TapeProtect = 0;
-  if (Verbose) puts ("OK");
+  if (Verbose) puts (ok? "OK":"FAILED");
 }
 
 /****************************************************************************/
-/*** Insert cassette tape file.                                           ***/
+/*** Print the files on the cassette                                      ***/
 /****************************************************************************/
-void InsertCassette(const char *filename, FILE *f, int readOnly)
+void ListCassette(void)
 {
-  if (Verbose) printf("Opening cassette file %s", filename);
-  if (Verbose) printf(readOnly ? " (readonly)... " : "... ");
-  if (!f) {
+  const TapeFile *F;
+  int i,n;
+
+  if (!TapeImage) return;
+  F=Tape_Files (TapeImage,&n);
+  printf ("%ld block%s, %d file%s\n",Tape_Blocks (TapeImage),
+          Tape_Blocks (TapeImage)==1? "":"s",n,n==1? "":"s");
+  for (i=0;i<n;++i)
+    printf ("  %3ld %-16s %-3s %c %5u bytes at %04X\n",F[i].Block,F[i].Name,
+            F[i].Ext,isprint(F[i].Type)? F[i].Type:'?',F[i].Length,F[i].Addr);
+}
+
+/****************************************************************************/
+/*** Insert a cassette tape image, taking over any previous one           ***/
+/****************************************************************************/
+static void InsertTape(const char *filename, Tape *T, int readOnly)
+{
+  static char _TapeName[FILENAME_MAX];
+
+  if (!T) {
     if (Verbose) puts("FAILED");
     return;
   }
-
-  static char _TapeName[FILENAME_MAX];
   strcpy (_TapeName,filename);
   TapeName=_TapeName;
 
-  if (TapeStream) fclose (TapeStream); //close previous stream
+  // a read-only image is written to an overlay, if there is one. An
+  // overlay of another image, e.g. an older version of this one, is moved
+  // aside to <overlay>.old; if that is taken, the tape stays read-only
+  readOnly |= T->ReadOnly;
+  if (readOnly && TapeOverlayName) {
+    char old[FILENAME_MAX];
+    FILE *f = fopen (TapeOverlayName, "r+b");
+    Tape *O = Tape_OpenOverlay (T, f ? f : fopen (TapeOverlayName, "w+b"));
+    if (!O && f) {
+      snprintf (old,sizeof(old),"%s.old",TapeOverlayName);
+      if ((f = fopen (old, "rb")))
+        fclose (f);
+      else if (!rename (TapeOverlayName,old)) {
+        if (Verbose) printf ("moved overlay aside to %s... ", old);
+        O = Tape_OpenOverlay (T, fopen (TapeOverlayName, "w+b"));
+      }
+    }
+    if (O) {
+      if (Verbose) printf ("with overlay %s... ", TapeOverlayName);
+      T = O;
+      readOnly = 0;
+    }
+  }
+
+  if (TapeImage) Tape_Close (TapeImage); //close previous image
   TapeProtect = readOnly;
-  TapeStream = f;
-  rewind (TapeStream);
+  TapeImage = T;
+  SignalTape = NULL;
   if (Verbose) puts("OK");
+  if (Verbose&4) ListCassette ();
+}
+
+/****************************************************************************/
+/*** Insert cassette tape file.                                           ***/
+/****************************************************************************/
+void InsertCassette(const char *filename, FILE *f, int readOnly)
+{
+  if (Verbose) printf("Opening cassette file %s", filename);
+  if (Verbose) printf(readOnly ? " (readonly)... " : "... ");
+  InsertTape(filename, f ? Tape_OpenFile(f, readOnly) : NULL, readOnly);
+}
+
+/****************************************************************************/
+/*** Insert a cassette tape image from memory                             ***/
+/****************************************************************************/
+void InsertCassetteData(const char *filename, const void *data, long size, int readOnly)
+{
+  if (Verbose) printf("Opening cassette image %s", filename);
+  if (Verbose) printf(readOnly ? " (readonly)... " : "... ");
+  InsertTape(filename, data ? Tape_OpenMemory(data, size, readOnly) : NULL, readOnly);
 }
 
 /****************************************************************************/
@@ -415,6 +759,7 @@ void InsertCartridge(const char *filename, FILE *f)
 int Z80_Interrupt(void)
 {
  static int UCount=1;
+ ++Interrupts;
  Keyboard ();
  FlushSound ();
  if (!--UCount)
@@ -422,6 +767,9 @@ int Z80_Interrupt(void)
   UCount=UPeriod;
   RefreshScreen ();
  }
+ // a loader reading the tape itself is run as fast as possible
+ TapeStreaming=TapeTurbo && SignalPolled;
+ SignalPolled=0;
  SyncEmulation();
  if (NMI) {
   NMI=0; //reset flag
@@ -433,25 +781,91 @@ int Z80_Interrupt(void)
 void Z80_Reti (void) { }
 void Z80_Retn (void) { }
 
+/* P2000 ROM tape system variables */
+#define caserror       0x6017
+#define lengte         0x601A
+#define recleng        0x6034
+#define transfer       0x6030
+#define telblok        0x606E
+#define stacas         0x6060
+#define motorstat      0x6050
+#define desleng        0x606A
+#define des1           0x6068
+#define descrip        0x6030
+#define recnum         0x604F
+#define fileleng       0x6032
+
+/****************************************************************************/
+/*** Read LoadBlocks blocks from tape to LoadAddr. A block read to video  ***/
+/*** memory is shown as a loading picture, one 80 byte slice every        ***/
+/*** TapeLoadDelay interrupts. Returns 0 while a picture is still being   ***/
+/*** shown, in which case it should be called again later on              ***/
+/****************************************************************************/
+static int ReadBlocks (void)
+{
+ const byte *block;
+ int j,l,m;
+ for (;;)
+ {
+  if (LoadPicture)
+  {
+   for (;LoadPos<LoadLength;LoadPos+=80)
+   {
+    if (Interrupts-LoadTime<(unsigned)TapeLoadDelay) return 0;
+    LoadTime=Interrupts;
+    for (m=LoadPos;m<LoadLength && m<(LoadPos+80);++m)
+     Z80_WRMEM((LoadAddr+m)&0xFFFF,LoadBuf[m+HEADER_SIZE]);
+   }
+   LoadPicture=0;
+   LoadAddr=(LoadAddr+1024)&0xFFFF;
+  }
+  if (!LoadBlocks) return 1;
+  /* The cassette may have been removed while showing the picture */
+  if (!TapeImage)
+  {
+   Z80_WRMEM (caserror,0x41);
+   LoadBlocks=0;
+   return 1;
+  }
+  --LoadBlocks;
+  block=Tape_Read (TapeImage,TAPE_BLOCK_SIZE);
+  if (!block)
+  {
+   Z80_WRMEM (caserror,0x4D);
+   LoadBlocks=0;
+   return 1;
+  }
+  for (j=0;j<0x20;++j)
+   Z80_WRMEM (0x6030+j,block[j+HEADER_OFFSET]);
+  l=m=Z80_RDWORD (lengte);
+  if (l>1024) l=1024;
+  Z80_WRWORD (lengte,m-l);
+  if (LoadAddr>=0x5000 && LoadAddr<0x6000 && TapeLoadDelay)
+  {
+   /* We're reading to video memory. Emulate a loading picture. The */
+   /* cassette may be changed meanwhile, so keep a copy of the block */
+   memcpy (LoadBuf,block,TAPE_BLOCK_SIZE);
+   LoadPicture=1;
+   LoadPos=0;
+   LoadLength=l;
+   LoadTime=Interrupts-TapeLoadDelay;
+  }
+  else
+  {
+   for (j=0;j<l;++j)
+    Z80_WRMEM((LoadAddr+j)&0xFFFF,block[j+HEADER_SIZE]);
+   LoadAddr=(LoadAddr+1024)&0xFFFF;
+  }
+ }
+}
+
 /****************************************************************************/
 /*** This is called when ED FE occurs and is used to emulate tape and     ***/
 /*** access                                                               ***/
 /****************************************************************************/
 void Z80_Patch (Z80_Regs *R)
 {
- #define caserror       0x6017
- #define lengte         0x601A
- #define recleng        0x6034
- #define transfer       0x6030
- #define telblok        0x606E
- #define stacas         0x6060
- #define motorstat      0x6050
- #define desleng        0x606A
- #define des1           0x6068
- #define descrip        0x6030
- #define recnum         0x604F
- #define fileleng       0x6032
- static byte tapebuf[1024+256] = {0};
+ static byte tapebuf[TAPE_BLOCK_SIZE] = {0};
  int i,j,k,l,m;
  switch (R->PC.W.l-2)
  {
@@ -459,13 +873,18 @@ void Z80_Patch (Z80_Regs *R)
   /** 0x04F1: Tape functions                                               **/
   /**************************************************************************/
   case 0x04F1:
-   if (Verbose&4) printf ("Tape function called: ");
-   Z80_WRWORD (lengte,Z80_RDWORD(recleng));
-   Z80_WRWORD (des1,Z80_RDWORD(descrip));
-   Z80_WRWORD (desleng,0x20);
-   Z80_WRMEM (telblok,Z80_RDMEM(recnum));
-   //every tape interaction sets/enables the keyboard interrupt
-   OutputReg|=0x40; //set keyboard interrupt in output reg
+   // a loading picture interrupted by a reset is abandoned
+   if (LoadPicture && R->AF.B.h!=6) LoadPicture=LoadBlocks=0;
+   if (!LoadPicture)
+   {
+    if (Verbose&4) printf ("Tape function called: ");
+    Z80_WRWORD (lengte,Z80_RDWORD(recleng));
+    Z80_WRWORD (des1,Z80_RDWORD(descrip));
+    Z80_WRWORD (desleng,0x20);
+    Z80_WRMEM (telblok,Z80_RDMEM(recnum));
+    //every tape interaction sets/enables the keyboard interrupt
+    OutputReg|=0x40; //set keyboard interrupt in output reg
+   }
    switch (R->AF.B.h)
    {
     /*************************************************************************
@@ -485,9 +904,9 @@ void Z80_Patch (Z80_Regs *R)
     *************************************************************************/
     case 1:
      if (Verbose&4) puts ("Rewind tape");
-     if (TapeStream)
+     if (TapeImage)
      {
-      rewind (TapeStream);
+      Tape_Seek (TapeImage,0);
       Z80_WRMEM (caserror,0);
      }
      else
@@ -502,22 +921,15 @@ void Z80_Patch (Z80_Regs *R)
      i=Z80_RDMEM (telblok);
      if (Verbose&4)
       printf ("Skip block (forward): %u block%s\n",i,(i==1)? "":"s");
-     if (TapeStream)
+     if (TapeImage)
      {
-      j=ftell (TapeStream);
-      if (fseek (TapeStream,j+i*(1024+HEADER_SIZE)-1,SEEK_SET))
+      if (!Tape_SeekBlock (TapeImage,TapeImage->Pos/TAPE_BLOCK_SIZE+i))
       {
-       rewind (TapeStream);
+       Tape_Seek (TapeImage,0);
        Z80_WRMEM (caserror,0x45);
       }
       else
-       if ((j=fgetc(TapeStream))==EOF)
-       {
-        rewind (TapeStream);
-        Z80_WRMEM (caserror,0x45);
-       }
-       else
-        Z80_WRMEM (caserror,0);
+       Z80_WRMEM (caserror,0);
      }
      else
       Z80_WRMEM (caserror,0x41);
@@ -531,26 +943,20 @@ void Z80_Patch (Z80_Regs *R)
      i=Z80_RDMEM (telblok);
      if (Verbose&4)
       printf ("Skip block (backward): %u block%s\n",i,(i==1)? "":"s");
-     if (TapeStream)
+     if (TapeImage)
      {
-      j=ftell (TapeStream);
-      if (fseek (TapeStream,j-i*(1024+HEADER_SIZE),SEEK_SET))
+      j=TapeImage->Pos/TAPE_BLOCK_SIZE-i;
+      /* there must be a block to read at the new position */
+      if (j>=Tape_Blocks (TapeImage) || !Tape_SeekBlock (TapeImage,j))
       {
-       rewind (TapeStream);
+       Tape_Seek (TapeImage,0);
        Z80_WRMEM (caserror,0x45);
       }
       else
-       if ((j=fgetc(TapeStream))==EOF)
-       {
-        rewind (TapeStream);
-        Z80_WRMEM (caserror,0x45);
-       }
-       else
-       {
-        Z80_WRMEM (caserror,0);
-        ungetc (j,TapeStream);
-        Z80_WRMEM (telblok,0);
-       }
+      {
+       Z80_WRMEM (caserror,0);
+       Z80_WRMEM (telblok,0);
+      }
      }
      else
       Z80_WRMEM (caserror,0x41);
@@ -563,14 +969,17 @@ void Z80_Patch (Z80_Regs *R)
     case 4:
      if (Verbose&4) puts ("EOT");
      /* Truncate the tape image */
-     if (TapeStream && !TapeProtect)
+     if (TapeImage && !TapeProtect)
      {
-      if (ftruncate(fileno(TapeStream),ftell(TapeStream)) != 0)
-        if (Verbose&4) puts ("EOT ftruncate error");
+      if (!Tape_Truncate (TapeImage))
+        if (Verbose&4) puts ("EOT truncate error");
+      /* The end of a save: have the blocks written put on disk */
+      if (!Tape_Flush (TapeImage,0))
+        if (Verbose&4) puts ("EOT write error");
       Z80_WRMEM (caserror,0);
      }
      else
-      Z80_WRMEM (caserror,(TapeStream)? 0x47:0x41);
+      Z80_WRMEM (caserror,(TapeImage)? 0x47:0x41);
      break;
     /*************************************************************************
        Write blocks
@@ -587,7 +996,7 @@ void Z80_Patch (Z80_Regs *R)
      if (Verbose&4)
       printf ("Write block: %u bytes, %u block%s at %04X\n",
               Z80_RDWORD(lengte),i,(i==1)?"":"s",k);
-     if (TapeStream && !TapeProtect)
+     if (TapeImage && !TapeProtect)
      {
       Z80_WRMEM (caserror,0);
       for (;i;--i)
@@ -603,16 +1012,16 @@ void Z80_Patch (Z80_Regs *R)
        for (j=l;j<1024;++j)
         tapebuf[j+HEADER_SIZE]=0;
        k=(k+1024)&0xFFFF;
-       if (!fwrite(tapebuf,1024+HEADER_SIZE,1,TapeStream))
+       if (!Tape_Write (TapeImage,tapebuf,TAPE_BLOCK_SIZE))
        {
-        rewind (TapeStream);
+        Tape_Seek (TapeImage,0);
         Z80_WRMEM (caserror,0x45);
         break;
        }
       }
      }
      else
-      Z80_WRMEM (caserror,(TapeStream)? 0x47:0x41);
+      Z80_WRMEM (caserror,(TapeImage)? 0x47:0x41);
      break;
     /*************************************************************************
        Read blocks
@@ -623,50 +1032,23 @@ void Z80_Patch (Z80_Regs *R)
     *************************************************************************/
     case 6:
     {
-     i=Z80_RDWORD(fileleng);
-     i=(i-1)&0xFFFF;
-     i=(i/0x400)+1;
-     k=Z80_RDWORD(transfer);
-     if (Verbose&4)
-      printf ("Read block: %u bytes, %u block%s at %04X\n",
-              Z80_RDWORD(lengte),i,(i==1)?"":"s",k);
-     if (TapeStream)
+     if (!LoadPicture)
      {
-      for (;i;--i)
-      {
-       if (!fread(tapebuf,1024+HEADER_SIZE,1,TapeStream))
-       {
-        Z80_WRMEM (caserror,0x4D);
-        break;
-       }
-       for (j=0;j<0x20;++j)
-        Z80_WRMEM (0x6030+j,tapebuf[j+HEADER_OFFSET]);
-       l=m=Z80_RDWORD (lengte);
-       if (l>1024) l=1024;
-       Z80_WRWORD (lengte,m-l);
-       if (k>=0x5000 && k<0x6000)
-       {
-        /* We're reading to video memory. Emulate a loading picture */
-        for (j=0;j<l;j+=80)
-        {
-         for (m=j;m<l && m<(j+80);++m)
-          Z80_WRMEM((k+m)&0xFFFF,tapebuf[m+HEADER_SIZE]);
-         RefreshScreen ();
-         Keyboard ();
-         if (!Z80_Running) return;
-         Pause (200);
-        }
-       }
-       else
-       {
-        for (j=0;j<l;++j)
-         Z80_WRMEM((k+j)&0xFFFF,tapebuf[j+HEADER_SIZE]);
-       }
-       k=(k+1024)&0xFFFF;
-      }
+      i=Z80_RDWORD(fileleng);
+      i=(i-1)&0xFFFF;
+      LoadBlocks=(i/0x400)+1;
+      LoadAddr=Z80_RDWORD(transfer);
+      if (Verbose&4)
+       printf ("Read block: %u bytes, %u block%s at %04X\n",
+               Z80_RDWORD(lengte),LoadBlocks,(LoadBlocks==1)?"":"s",
+               LoadAddr);
+     }
+     if (!ReadBlocks())
+     {
+      /* Execute the patch again until the loading picture is complete */
+      R->PC.W.l-=2;
+      return;
      }
-     else
-      Z80_WRMEM (caserror,0x41);
      break;
     }
     /*************************************************************************
@@ -705,8 +1087,6 @@ void Z80_Patch (Z80_Regs *R)
     R->AF.B.l&=0xBF;
    else
     R->AF.B.l|=0x40;
-   if (TapeStream)
-    fseek (TapeStream,ftell(TapeStream),SEEK_SET);
    break;
   /**************************************************************************/
   /** 0x0E5D: Output a byte to the serial port                             **/
@@ -728,13 +1108,98 @@ void Z80_Patch (Z80_Regs *R)
 
 // when doblank is 1, flashing characters are not displayed this refresh
 static int doblank=1;
+// blanking state of the last screen drawn by DrawScreen()
+static int drawnblank=1;
+
+// flashing cells found by the last full refresh, so a change of the
+// blanking state can be handled by only redrawing these cells
+typedef struct
+{
+  byte x, y;
+  byte c, blank_c; // character when shown and when blanked
+  byte fg, bg, si;
+} FlashCell;
+static FlashCell FlashCells[80*24];
+static int FlashCount = 0;
+static byte FlashVRAM[0x1000]; // VRAM contents at the last full refresh
+static byte FlashScrollReg;
+static int FlashValid = 0; // 0 if the last full refresh replayed writes
+static byte RasterVRAM[0x1000]; // VRAM while replaying the writes of a frame
+
+/* Convert a character to its contiguous or separated graphics variant */
+static int GraphicsChar(int c, int separated)
+{
+  if (c & 0x20) // c from 32..63 or 96..127
+  {
+    c += (c & 0x40) ? 64 : 96;
+    if (separated)
+      c += 64;
+  }
+  return c;
+}
+
+/* Start decoding a snapshot, returns the video RAM to decode from */
+static const byte *StartRefresh(const VideoState *V)
+{
+  memcpy(FlashVRAM, V->VRAM, sizeof(FlashVRAM));
+  FlashScrollReg = V->ScrollReg;
+  FlashValid = !V->Writes;
+  FlashCount = 0;
+  if (!V->Writes)
+    return V->VRAM;
+  memcpy(RasterVRAM, V->VRAM, sizeof(RasterVRAM));
+  return RasterVRAM;
+}
+
+/* Replay the writes done before row y was displayed, starting at write *w.
+   Scroll register writes go to *scroll, unless it is NULL */
+static void ReplayWrites(const VideoState *V, int y, int *w, int *scroll)
+{
+  const VideoWrite *W;
+  for (W = V->Write + *w; *w < V->Writes && W->Row <= y; ++*w, ++W)
+  {
+    if (W->Addr == VIDEO_SCROLL)
+    {
+      if (scroll)
+        *scroll = W->Value;
+    }
+    else
+      RasterVRAM[W->Addr] = W->Value;
+  }
+}
+
+/* Remember a flashing cell for the next blanking state change */
+static void AddFlashCell(int x, int y, int c, int blank_c, int fg, int bg, int si)
+{
+  FlashCell *F = &FlashCells[FlashCount++];
+  F->x = x;
+  F->y = y;
+  F->c = c - 32;
+  F->blank_c = blank_c - 32;
+  F->fg = fg;
+  F->bg = bg;
+  F->si = si;
+}
+
+/****************************************************************************/
+/*** Put a character in the display buffer and in the cell streams        ***/
+/****************************************************************************/
+static void PutCell(int x, int y, int c, int fg, int bg, int si)
+{
+  PutChar(x, y, c, fg, bg, si);
+  if (Capture)
+    CellStream_Put(Capture, x, y, c, fg, bg, si);
+  if (Remote)
+    Remote_Put(x, y, c, fg, bg, si);
+}
 
 /****************************************************************************/
 /*** Refresh screen (P2000T model)                                        ***/
 /****************************************************************************/
-void RefreshScreen_T(void)
+static void RefreshScreen_T(const VideoState *V)
 {
-  byte *S;
+  const byte *S, *vram;
+  int scroll, offset, w;
   int fg, bg, si, gr, fl, cg, FG, BG, conceal;
   int hg, hg_active, hg_c, hg_fg, hg_cg, hg_conceal;
   int x, y;
@@ -742,12 +1207,19 @@ void RefreshScreen_T(void)
   int lastcolor;
   int eor;
   int found_si;
+  int blank_c;
 
-  S = VRAM + ScrollReg;
+  vram = StartRefresh(V);
+  scroll = V->ScrollReg;
+  offset = 0;
+  w = 0;
   found_si = 0; // init to no double height codes found
 
   for (y = 0; y < 24; ++y)
   {
+    ReplayWrites(V, y, &w, &scroll);
+    S = vram + scroll + offset;
+
     /* Initial values:
        foreground=7 (white)
        background=0 (black)
@@ -885,21 +1357,22 @@ void RefreshScreen_T(void)
       if (hg_active)
         c = hg_c;
 
-      /* Check for flashing characters and concealed display */
-      if ((fl && doblank) || (hg_active ? hg_conceal : conceal))
+      /* Check for concealed display */
+      if (hg_active ? hg_conceal : conceal)
         c = SPACE;
+      /* Flashing characters are shown as space when blanked */
+      blank_c = fl ? SPACE : c;
 
       /* Check if graphics are on */
-      if ((gr || hg_active) && (c & 0x20)) // c from 32..63
+      if (gr || hg_active)
       {
-        c += (c & 0x40) ? 64 : 96;
-        if (!(hg_active ? hg_cg : cg))
-          c += 64;
+        c = GraphicsChar(c, !(hg_active ? hg_cg : cg));
+        blank_c = GraphicsChar(blank_c, !(hg_active ? hg_cg : cg));
       }
       /* If double height code on previous line and double height
          is not set, display a space character */
       if (found_si == 2 && !si)
-        c = SPACE;
+        c = blank_c = SPACE;
 
       /* Get the foreground and background colours */
       FG = (hg_active ? hg_fg : fg);
@@ -909,8 +1382,11 @@ void RefreshScreen_T(void)
         FG = FG ^ 7;
         BG = BG ^ 7;
       }
+      /* Remember flashing cells for the next blanking state change */
+      if (c != blank_c)
+        AddFlashCell(x, y, c, blank_c, FG, BG, si ? found_si : 0);
       /* Put the character in the screen buffer */
-      PutChar(x, y, c - 32, FG, BG, (si ? found_si : 0));
+      PutCell(x, y, (V->Blank ? blank_c : c) - 32, FG, BG, (si ? found_si : 0));
 
       // update HG mode
       hg_active = (hg && gr);
@@ -929,19 +1405,117 @@ void RefreshScreen_T(void)
     {
       if (++found_si == 3)
       {
-        S += 160;
+        offset += 160;
         found_si = 0;
       }
     }
     else
-      S += 80; // move to next line in VRAM
+      offset += 80; // move to next line in VRAM
   }
 }
 
 /****************************************************************************/
-/*** Refresh screen. This function updates the blanking state and then    ***/
-/*** calls RefreshScreen_T() and finally it calls PutImage() to copy the  ***/
-/*** off-screen buffer to the actual display                              ***/
+/*** Refresh screen (P2000M model). Each row holds 80 characters, shown   ***/
+/*** as plain text: the attributes and scrolling of the M are not known   ***/
+/****************************************************************************/
+static void RefreshScreen_M(const VideoState *V)
+{
+  const byte *S, *vram;
+  int w;
+  int x, y;
+  int c;
+
+  vram = StartRefresh(V);
+  w = 0;
+
+  for (y = 0; y < 24; ++y)
+  {
+    ReplayWrites(V, y, &w, NULL);
+    S = vram + y * 80;
+    for (x = 0; x < 80; ++x)
+    {
+      c = S[x] & 0x7f;
+      if (c < SPACE)
+        c = SPACE;
+      PutCell(x, y, c - 32, 7, 0, 0);
+    }
+  }
+}
+
+/****************************************************************************/
+/*** Refresh only the flashing cells found by the last full refresh       ***/
+/****************************************************************************/
+static void RefreshScreen_Flash(const VideoState *V)
+{
+  int i;
+  FlashCell *F;
+  for (i = 0, F = FlashCells; i < FlashCount; ++i, ++F)
+    PutCell(F->x, F->y, V->Blank ? F->blank_c : F->c, F->fg, F->bg, F->si);
+}
+
+/****************************************************************************/
+/*** Draw a snapshot of the video hardware. This function calls           ***/
+/*** RefreshScreen_T() or RefreshScreen_M() (or RefreshScreen_Flash()     ***/
+/*** when only the blanking state changed) and then it calls PutImage()   ***/
+/*** to copy the off-screen buffer to the actual display                  ***/
+/****************************************************************************/
+void DrawScreen(const VideoState *V)
+{
+  // Update the screen buffer. If only the blanking state changed, there
+  // is no need to decode the whole screen again
+  if (V->Blank != drawnblank && FlashValid && !V->Writes &&
+      V->ScrollReg == FlashScrollReg && 
+      !memcmp(V->VRAM, FlashVRAM, sizeof(FlashVRAM)))
+    RefreshScreen_Flash(V);
+  else if (P2000Model == P2000_M)
+    RefreshScreen_M(V);
+  else
+    RefreshScreen_T(V);
+  drawnblank = V->Blank;
+  // Record the changed cells, stop capturing on a write error
+  if (Capture && !CellStream_EndFrame(Capture))
+  {
+    if (Verbose) printf("Failed to write capture stream to %s\n", CaptureName);
+    CellStream_Close(Capture);
+    Capture = NULL;
+  }
+  if (Remote)
+    Remote_EndFrame();
+  // Put the image on the screen
+  PutImage();
+}
+
+/****************************************************************************/
+/*** Check if the video writes of this frame must be replayed per row.    ***/
+/*** That is only needed when the picture changed while it was shown and  ***/
+/*** all changes have been logged. If so, the snapshot gets the video RAM ***/
+/*** contents of the start of the frame                                   ***/
+/****************************************************************************/
+static int RasterFrame(void)
+{
+  int i, scroll;
+  VideoWrite *W;
+  if (!RasterScreen || UPeriod != 1 || VideoWriteCount > VIDEO_WRITES)
+    return 0;
+  for (i = 0; i < VideoWriteCount && !Video.Write[i].Row; ++i);
+  if (i == VideoWriteCount)
+    return 0; // all writes done before the first row was shown
+  // The snapshot gets the start of the frame. Replaying the log on it must
+  // give the current contents, else VRAM was changed behind our back
+  // (e.g. by loading a state)
+  memcpy(Video.VRAM, FrameVRAM, sizeof(Video.VRAM));
+  scroll = FrameScrollReg;
+  for (i = 0, W = Video.Write; i < VideoWriteCount; ++i, ++W)
+    if (W->Addr == VIDEO_SCROLL)
+      scroll = W->Value;
+    else
+      FrameVRAM[W->Addr] = W->Value;
+  return scroll == ScrollReg && !memcmp(FrameVRAM, VRAM, sizeof(FrameVRAM));
+}
+
+/****************************************************************************/
+/*** Refresh screen. This function updates the blanking state, takes a    ***/
+/*** snapshot of the video RAM and registers and passes it to PutScreen() ***/
 /****************************************************************************/
 void RefreshScreen(void)
 {
@@ -951,8 +1525,24 @@ void RefreshScreen(void)
   BCount++;
   if (BCount == 48 / UPeriod) doblank = 1;
   if (BCount == 64 / UPeriod) doblank = BCount = 0;
-  // Update the screen buffer
-  RefreshScreen_T();
-  // Put the image on the screen
-  PutImage();
-}
\ No newline at end of file
+  // Take the snapshot: the state at the start of the frame plus the writes
+  // to replay, or just the current state
+  if (RasterFrame())
+  {
+    Video.ScrollReg = FrameScrollReg;
+    Video.Writes = VideoWriteCount;
+  }
+  else
+  {
+    memcpy(Video.VRAM, VRAM, sizeof(Video.VRAM));
+    Video.ScrollReg = ScrollReg;
+    Video.Writes = 0;
+  }
+  Video.Blank = doblank;
+  // The current state is where the next frame starts
+  memcpy(FrameVRAM, VRAM, sizeof(FrameVRAM));
+  FrameScrollReg = ScrollReg;
+  VideoWriteCount = 0;
+  // Hand the snapshot to the front end
+  PutScreen(&Video);
+}
@@ -19,11 +19,18 @@
 
 // This file contains the P2000 hardware emulation function prototypes
 
+#ifndef _P2000_H
+#define _P2000_H
+
 #include <stdio.h>
 #include "Z80.h"            /* Z80 emulation declarations    */
 
 #define EMULATOR_VERSION "0.9.4"
 
+#define P2000_T 0               /* P2000T: 40 column colour teletext video  */
+#define P2000_M 1               /* P2000M: 80 column video                  */
+#define P2000_COLUMNS (P2000Model == P2000_M ? 80 : 40)
+
 #if defined(_WIN32) // Windows
 #define PATH_SEPARATOR '\\'
 #else // Linux and others
@@ -34,11 +41,17 @@
 extern byte Verbose;            /* Verbose messages ON/OFF                  */
 extern byte *VRAM,*RAM,*ROM;    /* Main and Video RAMs                      */
 extern int RAMSizeKb;           /* Amount of RAM installed in kilobytes     */
+extern int P2000Model;          /* P2000_T or P2000_M                       */
 extern const char *FontName;    /* Font file                                */
 extern const char *CartName;    /* Cartridge ROM file                       */
 extern const char *ROMName;     /* Main ROM file                            */
 extern const char *TapeName;    /* Tape image                               */
+extern struct Tape *TapeImage;  /* Inserted tape, see Tape.h, or NULL       */
+extern const char *TapeOverlayName; /* Overlay for read-only tapes or NULL  */
 extern const char *PrnName;     /* Printer log file                         */
+extern const char *CaptureName; /* Cell stream capture file or NULL         */
+extern const char *RemoteName;  /* Remote display socket or NULL            */
+extern const char *WavName;     /* Sound WAV capture file or NULL           */
 extern int PrnType;             /* Printer type                             */
 extern byte DISAReg;            /* Reg #0x70                                */
 extern byte SoundReg;           /* Reg #0x50                                */
@@ -53,6 +66,30 @@ extern int UPeriod;             /* Number of interrupts/screen update       */
 extern int IFreq;               /* Number of interrupts/second              */
 extern int Sync;                /* 1 if emulation should be synced          */
 extern int CpuSpeed;            /* default 100                              */
+extern int RasterScreen;        /* 1 to show mid-frame video changes        */
+extern int TapeLoadDelay;       /* Interrupts/loading picture slice, 0=off  */
+extern int TapeTurbo;           /* 1 to fast-forward custom tape loaders    */
+extern int TapeStreaming;       /* 1 while one reads the tape, skip syncing */
+/****************************************************************************/
+
+/******** Snapshot of the video hardware, taken on every screen refresh *****/
+#define VIDEO_WRITES 4096       /* Max. number of mid-frame writes logged   */
+#define VIDEO_SCROLL 0xFFFF     /* VideoWrite.Addr of a Reg #0x30 write     */
+typedef struct
+{
+  word Addr;                    /* Offset in VRAM or VIDEO_SCROLL           */
+  byte Value;                   /* Value written                            */
+  byte Row;                     /* First character row showing the write    */
+} VideoWrite;
+
+typedef struct
+{
+  byte VRAM[0x1000];            /* Video RAM contents (at the start of the  */
+  byte ScrollReg;               /* Reg #0x30     frame when Writes is set)  */
+  byte Blank;                   /* 1 if flashing characters are blanked     */
+  int Writes;                   /* Number of writes to replay, 0 if none    */
+  VideoWrite Write[VIDEO_WRITES]; /* Writes done while the frame was shown  */
+} VideoState;
 /****************************************************************************/
 
 /****************************************************************************/
@@ -63,7 +100,7 @@ int StartP2000(void);
 
 int InitP2000 (byte* monitor_rom, byte *cartridge_rom);
 
-/*** (re)Allocate RAM memory ***/
+/*** (re)Allocate RAM memory                                              ***/
 int InitRAM(void);
 
 /****************************************************************************/
@@ -76,6 +113,16 @@ void TrashP2000(void);
 /****************************************************************************/
 void InsertCassette(const char *filename, FILE *f, int readOnly);
 
+/****************************************************************************/
+/*** Insert a copy of a cassette image in memory, e.g. from an archive    ***/
+/****************************************************************************/
+void InsertCassetteData(const char *filename, const void *data, long size, int readOnly);
+
+/****************************************************************************/
+/*** Print the files on the current cassette                              ***/
+/****************************************************************************/
+void ListCassette(void);
+
 /****************************************************************************/
 /*** Removes current cassette                                             ***/
 /****************************************************************************/
@@ -92,10 +139,15 @@ void InsertCartridge(const char *filename, FILE *f);
 void RemoveCartridge(void);
 
 /****************************************************************************/
-/*** Refresh the screen (calls PutChar and PutImage)                      ***/
+/*** Refresh the screen (takes a snapshot and calls PutScreen)            ***/
 /****************************************************************************/
 void RefreshScreen (void);
 
+/****************************************************************************/
+/*** Draw a snapshot of the video hardware (calls PutChar and PutImage)   ***/
+/****************************************************************************/
+void DrawScreen (const VideoState *V);
+
 /****************************************************************************/
 /*** Allocate resources needed by the machine-dependent code              ***/
 /************************************************** TO BE WRITTEN BY USER ***/
@@ -111,6 +163,12 @@ void PutChar(int x, int y, int c, int fg, int bg, int si);
 /************************************************** TO BE WRITTEN BY USER ***/
 void PutImage(void);
 
+/****************************************************************************/
+/*** Display a snapshot of the video hardware. The snapshot is only valid ***/
+/*** during this call, so either draw it with DrawScreen() or copy it     ***/
+/************************************************** TO BE WRITTEN BY USER ***/
+void PutScreen(const VideoState *V);
+
 /****************************************************************************/
 /*** Deallocate all resources taken by InitMachine()                      ***/
 /************************************************** TO BE WRITTEN BY USER ***/
@@ -123,12 +181,7 @@ void TrashMachine(void);
 void Keyboard (void);
 
 /****************************************************************************/
-/*** This function is called on writes to the sound register              ***/
-/************************************************** TO BE WRITTEN BY USER ***/
-void Sound(int toggle);
-
-/****************************************************************************/
-/*** Flush sound pipes                                                    ***/
+/*** Flush sound pipes (render the samples with Beeper_Render())          ***/
 /*** This function is called on every interrupt                           ***/
 /************************************************** TO BE WRITTEN BY USER ***/
 void FlushSound(void);
@@ -164,4 +217,6 @@ char *GetDocumentsPath (void);
 /****************************************************************************/
 /*** Used to shows breaking error messages                                ***/
 /************************************************** TO BE WRITTEN BY USER ***/
-void ShowErrorMessage(const char *format, ...);
\ No newline at end of file
+void ShowErrorMessage(const char *format, ...);
+
+#endif /* _P2000_H */
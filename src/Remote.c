@@ -0,0 +1,149 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the remote display server
+
+#include "Remote.h"
+#include <string.h>
+
+#ifdef _WIN32
+
+/* Unix domain sockets are not supported on this platform */
+int Remote_Open(const char *path, const CellStreamInfo *Info) { return 0; }
+void Remote_Put(int x, int y, int c, int fg, int bg, int si) { }
+void Remote_EndFrame(void) { }
+void Remote_Close(void) { }
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0          /* SO_NOSIGPIPE is used instead            */
+#endif
+
+static int Listener = -1;
+static int Clients[REMOTE_CLIENTS];
+static int ClientCount = 0;
+static CellStream *Cells = NULL;
+static byte Header[CELLSTREAM_HEADER_SIZE];
+static byte KeyFrame[2+4*CELLSTREAM_MAX_CELLS];
+static struct sockaddr_un Address;
+
+/****************************************************************************/
+/*** Send a buffer without blocking. Returns 0 if it was not sent whole   ***/
+/****************************************************************************/
+static int Send(int fd, const byte *buf, int len)
+{
+  return send(fd, buf, len, MSG_NOSIGNAL) == len;
+}
+
+static void Disconnect(int i)
+{
+  close(Clients[i]);
+  Clients[i] = Clients[--ClientCount];
+}
+
+/****************************************************************************/
+/*** Listen for viewers on a Unix domain socket                           ***/
+/****************************************************************************/
+int Remote_Open(const char *path, const CellStreamInfo *Info)
+{
+  struct stat st;
+
+  if (strlen(path) >= sizeof(Address.sun_path))
+    return 0;
+  memset(&Address, 0, sizeof(Address));
+  Address.sun_family = AF_UNIX;
+  strcpy(Address.sun_path, path);
+  // remove the socket left behind by an earlier run, but nothing else
+  if (!lstat(path, &st) && S_ISSOCK(st.st_mode))
+    unlink(path);
+  if ((Listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    return 0;
+  if (bind(Listener, (struct sockaddr *)&Address, sizeof(Address)) ||
+      listen(Listener, REMOTE_CLIENTS) ||
+      fcntl(Listener, F_SETFL, O_NONBLOCK) ||
+      !(Cells = CellStream_Open(NULL, Info)))
+  {
+    close(Listener);
+    Listener = -1;
+    return 0;
+  }
+  CellStream_Header(Info, Header);
+  return 1;
+}
+
+/****************************************************************************/
+/*** Put a character cell in the current frame                            ***/
+/****************************************************************************/
+void Remote_Put(int x, int y, int c, int fg, int bg, int si)
+{
+  CellStream_Put(Cells, x, y, c, fg, bg, si);
+}
+
+/****************************************************************************/
+/*** Send the changed cells to the viewers and accept new viewers         ***/
+/****************************************************************************/
+void Remote_EndFrame(void)
+{
+  int i, fd, len;
+
+  len = CellStream_Record(Cells);
+  for (i = ClientCount - 1; i >= 0; --i)
+    if (!Send(Clients[i], Cells->Buf, len))
+      Disconnect(i);
+
+  while (ClientCount < REMOTE_CLIENTS && (fd = accept(Listener, NULL, NULL)) >= 0)
+  {
+#ifdef SO_NOSIGPIPE
+    i = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &i, sizeof(i));
+#endif
+    Clients[ClientCount++] = fd;
+    len = CellStream_KeyFrame(Cells, KeyFrame);
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) || !Send(fd, Header, sizeof(Header)) ||
+        !Send(fd, KeyFrame, len))
+      Disconnect(ClientCount - 1);
+  }
+}
+
+/****************************************************************************/
+/*** Disconnect all viewers and remove the socket                         ***/
+/****************************************************************************/
+void Remote_Close(void)
+{
+  while (ClientCount)
+    Disconnect(ClientCount - 1);
+  if (Listener >= 0)
+  {
+    close(Listener);
+    unlink(Address.sun_path);
+    Listener = -1;
+  }
+  if (Cells)
+    CellStream_Close(Cells);
+  Cells = NULL;
+}
+
+#endif /* _WIN32 */
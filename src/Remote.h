@@ -0,0 +1,54 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the remote display server prototypes. It sends the
+// character cells that changed on every drawn screen, in the cell stream
+// format of CellStream.h, to the viewers connected to a Unix domain socket
+
+#ifndef _REMOTE_H
+#define _REMOTE_H
+
+#include "CellStream.h"
+
+#define REMOTE_CLIENTS 8        /* Max. number of connected viewers        */
+
+/****************************************************************************/
+/*** Listen for viewers on a Unix domain socket. Returns 0 in case of a   ***/
+/*** failure                                                              ***/
+/****************************************************************************/
+int Remote_Open(const char *path, const CellStreamInfo *Info);
+
+/****************************************************************************/
+/*** Put a character cell in the current frame                            ***/
+/****************************************************************************/
+void Remote_Put(int x, int y, int c, int fg, int bg, int si);
+
+/****************************************************************************/
+/*** Send the changed cells to the viewers and accept new viewers, which  ***/
+/*** get the header and all cells first. Viewers that can not keep up     ***/
+/*** are disconnected, so the emulation never waits for them              ***/
+/****************************************************************************/
+void Remote_EndFrame(void);
+
+/****************************************************************************/
+/*** Disconnect all viewers and remove the socket                         ***/
+/****************************************************************************/
+void Remote_Close(void);
+
+#endif /* _REMOTE_H */
@@ -0,0 +1,138 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the front-end independent SAA5050 rasteriser. It does
+// the character rounding and double height handling for all front ends
+
+#include "SAA5050.h"
+#include <string.h>
+
+const byte SAA5050_Palette[8*3] =
+{
+  0x00,0x00,0x00, //black
+  0xFF,0x00,0x00, //red
+  0x00,0xFF,0x00, //green
+  0xFF,0xFF,0x00, //yellow
+  0x00,0x00,0xFF, //blue
+  0xFF,0x00,0xFF, //magenta
+  0x00,0xFF,0xFF, //cyan
+  0xFF,0xFF,0xFF  //white
+};
+
+/****************************************************************************/
+/*** Returns the lit quadrants of a font pixel. For character rounding    ***/
+/*** (alphanumeric chars only), look at the 8 pixels around the pixel     ***/
+/****************************************************************************/
+int SAA5050_Quadrants(const byte *font, int c, int line, int pos)
+{
+  const byte *glyph = font + c * SAA5050_CHAR_HEIGHT;
+  int bit = 0x20 >> pos; // bit 6 is the leftmost pixel
+  int prev = line > 0 ? glyph[line - 1] : 0;
+  int next = line < SAA5050_CHAR_HEIGHT - 1 ? glyph[line + 1] : 0;
+  int n, e, s, w, ne, se, sw, nw;
+  int quadrants = 0;
+
+  if (glyph[line] & bit)
+    return SAA5050_ALL;
+  if (c >= 96) // no rounding for graphics chars
+    return 0;
+
+  n  = prev & bit;
+  e  = glyph[line] & (bit >> 1);
+  s  = next & bit;
+  w  = glyph[line] & (bit << 1);
+  ne = prev & (bit >> 1);
+  se = next & (bit >> 1);
+  sw = next & (bit << 1);
+  nw = prev & (bit << 1);
+
+  if (n && w && !nw) quadrants |= SAA5050_NW; // rounding in NW direction
+  if (n && e && !ne) quadrants |= SAA5050_NE; // rounding in NE direction
+  if (s && e && !se) quadrants |= SAA5050_SE; // rounding in SE direction
+  if (s && w && !sw) quadrants |= SAA5050_SW; // rounding in SW direction
+  return quadrants;
+}
+
+/****************************************************************************/
+/*** Expand the 6x10 font to scaled glyphs with character rounding        ***/
+/****************************************************************************/
+void SAA5050_BuildFont(const byte *font, byte *glyphs, int scale)
+{
+  int c, line, pos, q, i;
+  int width = SAA5050_CHAR_WIDTH * scale;
+  int half = scale / 2;
+  byte *p;
+
+  memset(glyphs, 0, SAA5050_CHARS * SAA5050_CHAR_WIDTH * SAA5050_CHAR_HEIGHT * scale * scale);
+  for (c = 0; c < SAA5050_CHARS; ++c)
+    for (line = 0; line < SAA5050_CHAR_HEIGHT; ++line)
+      for (pos = 0; pos < SAA5050_CHAR_WIDTH; ++pos)
+      {
+        p = glyphs + (c * SAA5050_CHAR_HEIGHT + line) * scale * width + pos * scale;
+        if (scale == 1)
+        {
+          *p = (font[c * SAA5050_CHAR_HEIGHT + line] << pos) & 0x20 ? 0xFF : 0x00;
+          continue;
+        }
+        q = SAA5050_Quadrants(font, c, line, pos);
+        for (i = 0; i < half; ++i)
+        {
+          if (q & SAA5050_NW) memset(p + i * width, 0xFF, half);
+          if (q & SAA5050_NE) memset(p + i * width + half, 0xFF, half);
+          if (q & SAA5050_SW) memset(p + (i + half) * width, 0xFF, half);
+          if (q & SAA5050_SE) memset(p + (i + half) * width + half, 0xFF, half);
+        }
+      }
+}
+
+/****************************************************************************/
+/*** Draw a glyph on a character cell of a 16 or 32 bpp pixel buffer      ***/
+/****************************************************************************/
+void SAA5050_PutChar(void *buffer, int pitch, int bpp, const byte *glyphs,
+                     int scale, int x, int y, int c, dword fg, dword bg, int si)
+{
+  int i, j;
+  int width = SAA5050_CHAR_WIDTH * scale;
+  int height = SAA5050_CHAR_HEIGHT * scale;
+  const byte *glyph = glyphs + c * width * height + (si >> 1) * width * height / 2;
+
+  if (bpp == 16)
+  {
+    word *dst = (word *)buffer + x * width + y * height * pitch;
+    for (j = 0; j < height; ++j, dst += pitch)
+    {
+      for (i = 0; i < width; ++i)
+        dst[i] = glyph[i] ? fg : bg;
+      // double height chars use every glyph line twice
+      if (!si || (j & 1))
+        glyph += width;
+    }
+  }
+  else
+  {
+    dword *dst = (dword *)buffer + x * width + y * height * pitch;
+    for (j = 0; j < height; ++j, dst += pitch)
+    {
+      for (i = 0; i < width; ++i)
+        dst[i] = glyph[i] ? fg : bg;
+      if (!si || (j & 1))
+        glyph += width;
+    }
+  }
+}
@@ -0,0 +1,64 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the front-end independent SAA5050 rasteriser
+
+#ifndef _SAA5050_H
+#define _SAA5050_H
+
+#include "Z80.h"            /* byte, word and dword types    */
+
+#define SAA5050_CHARS       (96+64+64) /* alphanum + cont. + sep. graphics */
+#define SAA5050_CHAR_WIDTH  6
+#define SAA5050_CHAR_HEIGHT 10
+#define SAA5050_FONT_SIZE   (SAA5050_CHARS*SAA5050_CHAR_HEIGHT)
+
+/* Quadrants of a font pixel that are lit after character rounding */
+#define SAA5050_NW          1
+#define SAA5050_NE          2
+#define SAA5050_SW          4
+#define SAA5050_SE          8
+#define SAA5050_ALL         15
+
+/* RGB colours 0..7: black, red, green, yellow, blue, magenta, cyan, white */
+extern const byte SAA5050_Palette[8*3];
+
+/****************************************************************************/
+/*** Returns the lit quadrants (SAA5050_NW..SAA5050_SE) of pixel (pos,    ***/
+/*** line) of character c in a 6x10 font, including character rounding   ***/
+/****************************************************************************/
+int SAA5050_Quadrants(const byte *font, int c, int line, int pos);
+
+/****************************************************************************/
+/*** Expand a 6x10 font to SAA5050_CHARS glyphs of (6*scale)x(10*scale)   ***/
+/*** bytes, 0xFF for foreground and 0x00 for background. Scale must be 1  ***/
+/*** or even; character rounding needs a scale of at least 2              ***/
+/****************************************************************************/
+void SAA5050_BuildFont(const byte *font, byte *glyphs, int scale);
+
+/****************************************************************************/
+/*** Draw glyph c of a font built by SAA5050_BuildFont() on character     ***/
+/*** cell (x,y) of a 16 or 32 bits per pixel buffer. Pitch is in pixels, ***/
+/*** fg and bg are colours in the buffer's pixel format and si is 0 for   ***/
+/*** normal height, 1 or 2 for the top or bottom half of double height    ***/
+/****************************************************************************/
+void SAA5050_PutChar(void *buffer, int pitch, int bpp, const byte *glyphs,
+                     int scale, int x, int y, int c, dword fg, dword bg, int si);
+
+#endif /* _SAA5050_H */
@@ -0,0 +1,823 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the cassette tape image backends. A read-only image
+// in a regular file is memory mapped. Otherwise, the image is read into
+// memory and the bytes written are passed on to a writer thread, which
+// puts them in the file with stdio, so a save never waits for the disk.
+// A gzip compressed image is unpacked into memory and is read-only. An
+// overlay keeps the image in memory too, but stores the blocks written in
+// a file of its own. The file index is built from the block headers
+
+#include "Tape.h"
+#include "Gzip.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#define fsync(fd) _commit(fd)
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifndef __EMSCRIPTEN__
+#include <pthread.h>
+#endif
+#endif
+
+#define MEMORY_MIN_CAPACITY (16*TAPE_BLOCK_SIZE)
+
+/** TapeOp ***************************************************************/
+/** A file operation waiting for the writer thread                      **/
+/*************************************************************************/
+enum { OP_WRITE, OP_TRUNCATE, OP_SYNC };
+typedef struct TapeOp
+{
+  struct TapeOp *Next;          /* Next operation in the queue              */
+  int Type;                     /* OP_WRITE, OP_TRUNCATE or OP_SYNC         */
+  long Offset;                  /* Where to write or the new file size      */
+  long Len;                     /* Number of bytes in Data                  */
+  byte Data[];                  /* Bytes to write                           */
+} TapeOp;
+
+/** TapeWriter ***********************************************************/
+/** The write-behind queue of a tape and the thread draining it.        **/
+/** Without threads (Emscripten), operations are done right away        **/
+/*************************************************************************/
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define WRITER_THREADS
+#define Lock(W)      pthread_mutex_lock(&(W)->Mutex)
+#define Unlock(W)    pthread_mutex_unlock(&(W)->Mutex)
+#define Wait(W)      pthread_cond_wait(&(W)->Cond, &(W)->Mutex)
+#define WakeAll(W)   pthread_cond_broadcast(&(W)->Cond)
+#elif defined(_WIN32)
+#define WRITER_THREADS
+#define Lock(W)      EnterCriticalSection(&(W)->Mutex)
+#define Unlock(W)    LeaveCriticalSection(&(W)->Mutex)
+#define Wait(W)      SleepConditionVariableCS(&(W)->Cond, &(W)->Mutex, INFINITE)
+#define WakeAll(W)   WakeAllConditionVariable(&(W)->Cond)
+#endif
+
+struct TapeWriter
+{
+  FILE *F;                      /* File written to                          */
+  TapeOp *First, *Last;         /* Queue, oldest first                      */
+  int Busy;                     /* 1 while the thread does an operation     */
+  int Stop;                     /* Set to make the thread finish            */
+  int Error;                    /* 1 if an operation failed                 */
+#if defined(WRITER_THREADS) && defined(_WIN32)
+  HANDLE Thread;
+  CRITICAL_SECTION Mutex;
+  CONDITION_VARIABLE Cond;      /* Signals new operations and an idle queue */
+#elif defined(WRITER_THREADS)
+  pthread_t Thread;
+  pthread_mutex_t Mutex;
+  pthread_cond_t Cond;          /* Signals new operations and an idle queue */
+#endif
+};
+
+/****************************************************************************/
+/*** Do a file operation. Returns 0 on a failure                          ***/
+/****************************************************************************/
+static int DoOp(FILE *F, const TapeOp *Op)
+{
+  switch (Op->Type) {
+  case OP_WRITE:
+    return !fseek(F, Op->Offset, SEEK_SET) &&
+           fwrite(Op->Data, 1, Op->Len, F) == (size_t)Op->Len;
+  case OP_TRUNCATE:
+    return !fflush(F) && !ftruncate(fileno(F), Op->Offset);
+  default:
+    return !fflush(F) && !fsync(fileno(F));
+  }
+}
+
+#ifdef WRITER_THREADS
+/****************************************************************************/
+/*** The writer thread does the queued operations until it is told to     ***/
+/*** stop and the queue is empty. Whenever the queue runs empty the file  ***/
+/*** is flushed, so the bytes reach the OS soon after they're written     ***/
+/****************************************************************************/
+#ifdef _WIN32
+static DWORD WINAPI WriterThread(LPVOID arg)
+#else
+static void *WriterThread(void *arg)
+#endif
+{
+  struct TapeWriter *W = arg;
+  TapeOp *Op;
+  int ok;
+
+  Lock(W);
+  for (;;) {
+    while (!W->First && !W->Stop) Wait(W);
+    if (!(Op = W->First)) break;
+    if (!(W->First = Op->Next)) W->Last = NULL;
+    W->Busy = 1;
+    Unlock(W);
+    ok = DoOp(W->F, Op);
+    free(Op);
+    Lock(W);
+    if (ok && !W->First) ok = !fflush(W->F);
+    if (!ok) W->Error = 1;
+    W->Busy = 0;
+    WakeAll(W);
+  }
+  Unlock(W);
+  return 0;
+}
+#endif /* WRITER_THREADS */
+
+/****************************************************************************/
+/*** Start writing behind to the file of a tape. Returns 0 on a failure   ***/
+/****************************************************************************/
+static int StartWriter(Tape *T)
+{
+  struct TapeWriter *W;
+
+  if (!(W = calloc(1, sizeof(struct TapeWriter))))
+    return 0;
+  W->F = T->F;
+#if defined(WRITER_THREADS) && defined(_WIN32)
+  InitializeCriticalSection(&W->Mutex);
+  InitializeConditionVariable(&W->Cond);
+  if (!(W->Thread = CreateThread(NULL, 0, WriterThread, W, 0, NULL))) {
+    DeleteCriticalSection(&W->Mutex);
+    free(W);
+    return 0;
+  }
+#elif defined(WRITER_THREADS)
+  pthread_mutex_init(&W->Mutex, NULL);
+  pthread_cond_init(&W->Cond, NULL);
+  if (pthread_create(&W->Thread, NULL, WriterThread, W)) {
+    pthread_cond_destroy(&W->Cond);
+    pthread_mutex_destroy(&W->Mutex);
+    free(W);
+    return 0;
+  }
+#endif
+  T->Writer = W;
+  return 1;
+}
+
+/****************************************************************************/
+/*** Allocate an operation with room for len bytes                        ***/
+/****************************************************************************/
+static TapeOp *NewOp(int type, long offset, long len)
+{
+  TapeOp *Op;
+
+  if (!(Op = malloc(sizeof(TapeOp) + len)))
+    return NULL;
+  Op->Next = NULL;
+  Op->Type = type;
+  Op->Offset = offset;
+  Op->Len = len;
+  return Op;
+}
+
+/****************************************************************************/
+/*** Queue an operation for the writer thread, which frees it. Returns 0  ***/
+/*** if it is NULL or an earlier operation failed                         ***/
+/****************************************************************************/
+static int Queue(Tape *T, TapeOp *Op)
+{
+  struct TapeWriter *W = T->Writer;
+  int ok;
+
+  if (!Op)
+    return 0;
+#ifdef WRITER_THREADS
+  Lock(W);
+  if (W->Last) W->Last->Next = Op;
+  else W->First = Op;
+  W->Last = Op;
+  ok = !W->Error;
+  WakeAll(W);
+  Unlock(W);
+#else
+  if (!DoOp(W->F, Op)) W->Error = 1;
+  free(Op);
+  ok = !W->Error;
+#endif
+  return ok;
+}
+
+/****************************************************************************/
+/*** Write n bytes at offset behind                                       ***/
+/****************************************************************************/
+static int QueueWrite(Tape *T, long offset, const byte *buf, long n)
+{
+  TapeOp *Op;
+
+  if (!(Op = NewOp(OP_WRITE, offset, n)))
+    return 0;
+  memcpy(Op->Data, buf, n);
+  return Queue(T, Op);
+}
+
+/****************************************************************************/
+/*** Make the bytes written so far durable and wait for that if asked to. ***/
+/*** Returns 0 if an operation failed                                     ***/
+/****************************************************************************/
+static int FlushWriter(Tape *T, int wait)
+{
+  int ok;
+
+  ok = Queue(T, NewOp(OP_SYNC, 0, 0));
+#ifdef WRITER_THREADS
+  struct TapeWriter *W = T->Writer;
+  if (wait) {
+    Lock(W);
+    while (W->First || W->Busy) Wait(W);
+    ok = !W->Error;
+    Unlock(W);
+  }
+#endif
+  return ok;
+}
+
+/****************************************************************************/
+/*** Do the queued operations, make them durable and stop the thread      ***/
+/****************************************************************************/
+static int StopWriter(Tape *T)
+{
+  struct TapeWriter *W = T->Writer;
+  int ok;
+
+  if (!W)
+    return 1;
+  FlushWriter(T, 0);
+#if defined(WRITER_THREADS)
+  Lock(W);
+  W->Stop = 1;
+  WakeAll(W);
+  Unlock(W);
+#ifdef _WIN32
+  WaitForSingleObject(W->Thread, INFINITE);
+  CloseHandle(W->Thread);
+  DeleteCriticalSection(&W->Mutex);
+#else
+  pthread_join(W->Thread, NULL);
+  pthread_cond_destroy(&W->Cond);
+  pthread_mutex_destroy(&W->Mutex);
+#endif
+#endif
+  ok = !W->Error;
+  free(W);
+  T->Writer = NULL;
+  return ok;
+}
+
+/****************************************************************************/
+/*** Make room for size bytes in memory, doubling the buffer as needed    ***/
+/****************************************************************************/
+static int Grow(Tape *T, long size)
+{
+  long capacity;
+  byte *p;
+
+  if (size > T->Capacity) {
+    capacity = T->Capacity ? T->Capacity : MEMORY_MIN_CAPACITY;
+    while (capacity < size) capacity *= 2;
+    if (!(p = realloc(T->Data, capacity)))
+      return 0;
+    T->Data = p;
+    T->Capacity = capacity;
+  }
+  return 1;
+}
+
+/****************************************************************************/
+/*** Memory backend: the image is kept in a buffer                        ***/
+/****************************************************************************/
+static int MemoryResize(Tape *T, long size)
+{
+  if (!Grow(T, size))
+    return 0;
+  // a file grows by writing to it, but has to be cut off
+  if (T->Writer && size < T->Size &&
+      !Queue(T, NewOp(OP_TRUNCATE, size, 0)))
+    return 0;
+  T->Size = size;
+  return 1;
+}
+
+static int MemorySync(Tape *T, long offset, long len)
+{
+  if (!T->Writer)
+    return 1;
+  return QueueWrite(T, offset, T->Data + offset, len);
+}
+
+static void MemoryClose(Tape *T)
+{
+  StopWriter(T);
+  if (T->F) fclose(T->F);
+  if (T->Data) free(T->Data);
+}
+
+static const TapeBackend MemoryBackend = { MemoryResize, MemorySync, MemoryClose };
+
+#ifndef _WIN32
+/****************************************************************************/
+/*** Mmap backend for read-only images: map the file, unless it's empty   ***/
+/****************************************************************************/
+static int Map(Tape *T, long size)
+{
+  void *p;
+
+  if (!size)
+    return 1;
+  p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(T->F), 0);
+  if (p == MAP_FAILED)
+    return 0;
+  T->Data = p;
+  T->Capacity = size;
+  return 1;
+}
+
+static int MappedResize(Tape *T, long size)
+{
+  return 0;
+}
+
+static int MappedSync(Tape *T, long offset, long len)
+{
+  return 0;
+}
+
+static void MappedClose(Tape *T)
+{
+  if (T->Data) munmap(T->Data, T->Capacity);
+  fclose(T->F);
+}
+
+static const TapeBackend MappedBackend = { MappedResize, MappedSync, MappedClose };
+#endif /* !_WIN32 */
+
+/****************************************************************************/
+/*** Overlay backend: the image is kept in memory like the memory backend ***/
+/*** and each block written is stored in the overlay file, once. The file ***/
+/*** starts with OVERLAY_MAGIC, the size and hash of the base image and   ***/
+/*** the current image size, followed by records of a block number and    ***/
+/*** the block. All numbers are 32 bit little endian                      ***/
+/****************************************************************************/
+#define OVERLAY_MAGIC       "M2000COW"
+#define OVERLAY_HEADER_SIZE 20
+#define OVERLAY_RECORD_SIZE (4+TAPE_BLOCK_SIZE)
+
+static void PutDword(byte *p, dword v)
+{
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static dword GetDword(const byte *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (dword)p[3] << 24;
+}
+
+static dword Hash(const byte *p, long n)
+{
+  dword h = 2166136261u; // FNV-1a
+  while (n--) h = (h ^ *p++) * 16777619u;
+  return h;
+}
+
+static int OverlayWriteSize(Tape *T)
+{
+  byte buf[4];
+  PutDword(buf, T->Size);
+  return QueueWrite(T, 16, buf, 4);
+}
+
+static int OverlayResize(Tape *T, long size)
+{
+  if (!Grow(T, size))
+    return 0;
+  T->Size = size;
+  return OverlayWriteSize(T);
+}
+
+/* Remember where a block is stored in the overlay file */
+static int SetSlot(Tape *T, long block, long pos)
+{
+  long n, *p;
+
+  if (block >= T->SlotCount) {
+    n = T->SlotCount ? T->SlotCount : 64;
+    while (n <= block) n *= 2;
+    if (!(p = realloc(T->Slots, n * sizeof(long))))
+      return 0;
+    memset(p + T->SlotCount, 0, (n - T->SlotCount) * sizeof(long));
+    T->Slots = p;
+    T->SlotCount = n;
+  }
+  T->Slots[block] = pos;
+  return 1;
+}
+
+static int OverlaySync(Tape *T, long offset, long len)
+{
+  TapeOp *Op;
+  long b;
+
+  for (b = offset / TAPE_BLOCK_SIZE; len > 0 &&
+       b <= (offset + len - 1) / TAPE_BLOCK_SIZE; ++b) {
+    // a block written for the first time is appended
+    if (b >= T->SlotCount || !T->Slots[b]) {
+      if (!SetSlot(T, b, T->End))
+        return 0;
+      T->End += OVERLAY_RECORD_SIZE;
+    }
+    // the buffer holds whole blocks, see Grow()
+    if (!(Op = NewOp(OP_WRITE, T->Slots[b], OVERLAY_RECORD_SIZE)))
+      return 0;
+    PutDword(Op->Data, b);
+    memcpy(Op->Data + 4, T->Data + b * TAPE_BLOCK_SIZE, TAPE_BLOCK_SIZE);
+    if (!Queue(T, Op))
+      return 0;
+  }
+  return 1;
+}
+
+static void OverlayClose(Tape *T)
+{
+  StopWriter(T);
+  fclose(T->F);
+  free(T->Data);
+  free(T->Slots);
+}
+
+static const TapeBackend OverlayBackend = { OverlayResize, OverlaySync, OverlayClose };
+
+/****************************************************************************/
+/*** Read the blocks stored in the overlay file into the image. Returns 0 ***/
+/*** if the file isn't an overlay of this base image, -1 on an error      ***/
+/****************************************************************************/
+static int LoadOverlay(Tape *T, dword hash)
+{
+  byte buf[OVERLAY_RECORD_SIZE];
+  long size, b, pos;
+
+  if (fseek(T->F, 0, SEEK_SET) ||
+      fread(buf, OVERLAY_HEADER_SIZE, 1, T->F) != 1 ||
+      memcmp(buf, OVERLAY_MAGIC, 8) || GetDword(buf + 8) != (dword)T->Size ||
+      GetDword(buf + 12) != hash)
+    return 0;
+  size = GetDword(buf + 16);
+  if (!Grow(T, size))
+    return -1;
+  if (size > T->Size)
+    memset(T->Data + T->Size, 0, size - T->Size);
+  for (pos = OVERLAY_HEADER_SIZE;
+       fread(buf, OVERLAY_RECORD_SIZE, 1, T->F) == 1;
+       pos += OVERLAY_RECORD_SIZE) {
+    b = GetDword(buf);
+    if (!Grow(T, (b + 1) * TAPE_BLOCK_SIZE) || !SetSlot(T, b, pos))
+      return -1;
+    memcpy(T->Data + b * TAPE_BLOCK_SIZE, buf + 4, TAPE_BLOCK_SIZE);
+  }
+  T->Size = size;
+  T->End = pos;
+  return 1;
+}
+
+/****************************************************************************/
+/*** Open a tape image on an open file                                    ***/
+/****************************************************************************/
+Tape *Tape_OpenFile(FILE *F, int readOnly)
+{
+  byte magic[3], *data;
+  Tape *T;
+  long size;
+
+  if (!F)
+    return NULL;
+  // a compressed image is unpacked into memory and can't be written
+  size = fread(magic, 1, sizeof(magic), F);
+  if (Gzip_Check(magic, size)) {
+    data = !fseek(F, 0, SEEK_SET) ? Gzip_ReadFile(F, &size) : NULL;
+    fclose(F);
+    if (!data)
+      return NULL;
+    T = Tape_OpenMemory(data, size, 1);
+    free(data);
+    return T;
+  }
+  if (!(T = calloc(1, sizeof(Tape)))) {
+    fclose(F);
+    return NULL;
+  }
+  T->F = F;
+  T->ReadOnly = readOnly;
+#ifndef _WIN32
+  struct stat st;
+  if (readOnly && !fstat(fileno(F), &st) && S_ISREG(st.st_mode)) {
+    T->Backend = &MappedBackend;
+    if (Map(T, st.st_size)) {
+      T->Size = st.st_size;
+      Tape_Files(T, NULL);
+      return T;
+    }
+  }
+#endif
+  T->Backend = &MemoryBackend;
+  if (fseek(F, 0, SEEK_END) || (size = ftell(F)) < 0 ||
+      fseek(F, 0, SEEK_SET) || !MemoryResize(T, size) ||
+      fread(T->Data, 1, size, F) != (size_t)size ||
+      (!readOnly && !StartWriter(T))) {
+    Tape_Close(T);
+    return NULL;
+  }
+  Tape_Files(T, NULL);
+  return T;
+}
+
+/****************************************************************************/
+/*** Open a tape image on a copy of data                                  ***/
+/****************************************************************************/
+Tape *Tape_OpenMemory(const void *data, long size, int readOnly)
+{
+  byte *unpacked;
+  Tape *T;
+
+  if (Gzip_Check(data, size)) {
+    if (!(unpacked = Gzip_ReadData(data, size, &size)))
+      return NULL;
+    T = Tape_OpenMemory(unpacked, size, 1);
+    free(unpacked);
+    return T;
+  }
+  if (!(T = calloc(1, sizeof(Tape))))
+    return NULL;
+  T->ReadOnly = readOnly;
+  T->Backend = &MemoryBackend;
+  if (!MemoryResize(T, size)) {
+    Tape_Close(T);
+    return NULL;
+  }
+  if (size) memcpy(T->Data, data, size);
+  Tape_Files(T, NULL);
+  return T;
+}
+
+/****************************************************************************/
+/*** Open a writable copy-on-write tape image on a base image             ***/
+/****************************************************************************/
+Tape *Tape_OpenOverlay(Tape *Base, FILE *F)
+{
+  byte buf[OVERLAY_HEADER_SIZE];
+  Tape *T;
+  dword hash;
+
+  if (!F)
+    return NULL;
+  hash = Hash(Base->Data, Base->Size);
+  if (!(T = Tape_OpenMemory(Base->Data, Base->Size, 0))) {
+    fclose(F);
+    return NULL;
+  }
+  T->F = F;
+  T->Backend = &OverlayBackend;
+  switch (LoadOverlay(T, hash)) {
+  case -1:
+    Tape_Close(T);
+    return NULL;
+  case 0:
+    // an overlay made for another image is left alone, only an empty
+    // file is started afresh
+    if (fseek(F, 0, SEEK_END) || ftell(F) != 0) {
+      Tape_Close(T);
+      return NULL;
+    }
+    free(T->Slots);
+    T->Slots = NULL;
+    T->SlotCount = 0;
+    memcpy(buf, OVERLAY_MAGIC, 8);
+    PutDword(buf + 8, T->Size);
+    PutDword(buf + 12, hash);
+    PutDword(buf + 16, T->Size);
+    if (fseek(F, 0, SEEK_SET) ||
+        fwrite(buf, OVERLAY_HEADER_SIZE, 1, F) != 1 || fflush(F)) {
+      Tape_Close(T);
+      return NULL;
+    }
+    T->End = OVERLAY_HEADER_SIZE;
+    break;
+  }
+  if (!StartWriter(T)) {
+    Tape_Close(T);
+    return NULL;
+  }
+  T->Indexed = 0;
+  Tape_Files(T, NULL);
+  Tape_Close(Base);
+  return T;
+}
+
+/****************************************************************************/
+/*** Move to a position                                                   ***/
+/****************************************************************************/
+int Tape_Seek(Tape *T, long pos)
+{
+  if (pos < 0 || pos > T->Size)
+    return 0;
+  T->Pos = pos;
+  return 1;
+}
+
+/****************************************************************************/
+/*** Return n bytes at the tape position and move past them               ***/
+/****************************************************************************/
+const byte *Tape_Read(Tape *T, long n)
+{
+  const byte *p;
+
+  if (T->Size - T->Pos < n) {
+    T->Pos = T->Size;
+    return NULL;
+  }
+  p = T->Data + T->Pos;
+  T->Pos += n;
+  return p;
+}
+
+/****************************************************************************/
+/*** Write n bytes at the tape position                                   ***/
+/****************************************************************************/
+int Tape_Write(Tape *T, const byte *buf, long n)
+{
+  if (T->ReadOnly)
+    return 0;
+  T->Indexed = 0;
+  if (T->Pos + n > T->Size && !T->Backend->Resize(T, T->Pos + n))
+    return 0;
+  memcpy(T->Data + T->Pos, buf, n);
+  if (!T->Backend->Sync(T, T->Pos, n))
+    return 0;
+  T->Pos += n;
+  return 1;
+}
+
+/****************************************************************************/
+/*** Cut the image off at the tape position                               ***/
+/****************************************************************************/
+int Tape_Truncate(Tape *T)
+{
+  if (T->ReadOnly)
+    return 0;
+  T->Indexed = 0;
+  return T->Backend->Resize(T, T->Pos);
+}
+
+/****************************************************************************/
+/*** Make the bytes written so far durable                                ***/
+/****************************************************************************/
+int Tape_Flush(Tape *T, int wait)
+{
+  return !T->Writer || FlushWriter(T, wait);
+}
+
+/****************************************************************************/
+/*** Return the number of complete blocks on the tape                     ***/
+/****************************************************************************/
+long Tape_Blocks(const Tape *T)
+{
+  return T->Size / TAPE_BLOCK_SIZE;
+}
+
+/****************************************************************************/
+/*** Move to the start of a block or the end of the last one              ***/
+/****************************************************************************/
+int Tape_SeekBlock(Tape *T, long block)
+{
+  if (block < 0 || block > Tape_Blocks(T))
+    return 0;
+  T->Pos = block * TAPE_BLOCK_SIZE;
+  return 1;
+}
+
+/****************************************************************************/
+/*** Return the P2000 header of a block                                   ***/
+/****************************************************************************/
+const byte *Tape_Header(const Tape *T, long block)
+{
+  if (block < 0 || block >= Tape_Blocks(T))
+    return NULL;
+  return T->Data + block * TAPE_BLOCK_SIZE + TAPE_HEADER_OFFSET;
+}
+
+/****************************************************************************/
+/*** Copy n header characters, making them printable                      ***/
+/****************************************************************************/
+static void HeaderText(char *dst, const byte *src, int n)
+{
+  int i;
+  for (i = 0; i < n; ++i)
+    dst[i] = !src[i] ? ' ' : (src[i] < 32 || src[i] > 126) ? '?' : src[i];
+  dst[n] = '\0';
+}
+
+/****************************************************************************/
+/*** Number of blocks of the file starting at a block, like the ROM reads ***/
+/*** them, but at most up to the end of the tape                          ***/
+/****************************************************************************/
+static long FileBlocks(const Tape *T, long block)
+{
+  const byte *h = Tape_Header(T, block);
+  long n = (((h[2] | h[3] << 8) - 1) & 0xFFFF) / 1024 + 1;
+  long left = Tape_Blocks(T) - block;
+  return n < left ? n : left;
+}
+
+/****************************************************************************/
+/*** Return the files on the tape, building the index if needed           ***/
+/****************************************************************************/
+const TapeFile *Tape_Files(Tape *T, int *count)
+{
+  TapeFile *F;
+  const byte *h;
+  long b, blocks = Tape_Blocks(T);
+  int i, n;
+
+  if (!T->Indexed) {
+    free(T->Files);
+    T->Files = NULL;
+    T->FileCount = 0;
+    for (n = 0, b = 0; b < blocks; b += FileBlocks(T, b)) ++n;
+    if (n && !(T->Files = malloc(n * sizeof(TapeFile))))
+      n = 0;
+    else
+      for (F = T->Files, b = 0; b < blocks; b += F->Blocks, ++F) {
+        h = Tape_Header(T, b);
+        F->Block = b;
+        F->Blocks = FileBlocks(T, b);
+        F->Addr = h[0] | h[1] << 8;
+        F->Length = h[2] | h[3] << 8;
+        HeaderText(F->Name, h + 6, 8);
+        HeaderText(F->Name + 8, h + 23, 8);
+        for (i = TAPE_NAME_SIZE; i && F->Name[i - 1] == ' '; --i)
+          F->Name[i - 1] = '\0';
+        HeaderText(F->Ext, h + 14, 3);
+        F->Type = h[17];
+      }
+    T->FileCount = n;
+    T->Indexed = 1;
+  }
+  if (count) *count = T->FileCount;
+  return T->Files;
+}
+
+/****************************************************************************/
+/*** Compare two strings regardless of case                               ***/
+/****************************************************************************/
+static int SameText(const char *a, const char *b)
+{
+  while (*a && toupper((byte)*a) == toupper((byte)*b)) ++a, ++b;
+  return toupper((byte)*a) == toupper((byte)*b);
+}
+
+/****************************************************************************/
+/*** Return the index of the first file matching name and ext, or -1      ***/
+/****************************************************************************/
+int Tape_FindFile(Tape *T, const char *name, const char *ext)
+{
+  const TapeFile *F;
+  int i, n;
+
+  F = Tape_Files(T, &n);
+  for (i = 0; i < n; ++i)
+    if (SameText(F[i].Name, name) && (!ext || SameText(F[i].Ext, ext)))
+      return i;
+  return -1;
+}
+
+/****************************************************************************/
+/*** Close the image and free the tape                                    ***/
+/****************************************************************************/
+void Tape_Close(Tape *T)
+{
+  if (!T) return;
+  T->Backend->Close(T);
+  free(T->Files);
+  free(T);
+}
@@ -0,0 +1,176 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the cassette tape image, with a memory mapped file
+// and a plain memory backend. Either way the whole image is available as
+// one byte array, so reading and seeking are simple pointer arithmetic;
+// the backend only has to persist writes and changes of the image size,
+// which it does on a writer thread.
+// Writes to a read-only image can go to a copy-on-write overlay file.
+// An index of the files on the tape is kept for listing and finding them
+
+#ifndef _TAPE_H
+#define _TAPE_H
+
+#include <stdio.h>
+#include "Z80.h"            /* byte, word and dword types    */
+
+#define TAPE_HEADER_SIZE   256  /* .cas block header, the P2000 uses 32 */
+#define TAPE_HEADER_OFFSET 48   /* P2000 header data in the .cas header */
+#define TAPE_BLOCK_SIZE    (1024+TAPE_HEADER_SIZE)
+#define TAPE_NAME_SIZE     16   /* Description, split over the header   */
+
+typedef struct Tape Tape;
+
+/** TapeFile *************************************************************/
+/** A file on the tape: a run of blocks with the header of its first    **/
+/** block. The P2000 reads as many blocks as the file length needs      **/
+/*************************************************************************/
+typedef struct
+{
+  long Block;                   /* First block                              */
+  long Blocks;                  /* Number of blocks                         */
+  word Addr;                    /* Transfer address                         */
+  word Length;                  /* File length in bytes                     */
+  char Name[TAPE_NAME_SIZE+1];  /* Description, trailing spaces removed     */
+  char Ext[4];                  /* Extension, e.g. "BAS"                    */
+  char Type;                    /* File type, 'B' for BASIC programs        */
+} TapeFile;
+
+typedef struct
+{
+  /* Make the image size bytes long, keeping its data. Returns 0 if it   */
+  /* could not                                                           */
+  int (*Resize)(Tape *T, long size);
+  /* Persist the len bytes written at offset. Returns 0 on an error      */
+  int (*Sync)(Tape *T, long offset, long len);
+  /* Release the image and whatever the backend holds                    */
+  void (*Close)(Tape *T);
+} TapeBackend;
+
+struct Tape
+{
+  byte *Data;                   /* Image, Size bytes                        */
+  long Size;                    /* Image size                               */
+  long Pos;                     /* Tape position                            */
+  int ReadOnly;                 /* 1 if the image can't be written          */
+  const TapeBackend *Backend;   /* Backend functions                        */
+  FILE *F;                      /* File of the image or NULL                */
+  long Capacity;                /* Bytes allocated or mapped                */
+  long *Slots;                  /* Overlay file offset of each block or 0   */
+  long SlotCount;               /* Number of Slots allocated                */
+  long End;                     /* Overlay file size                        */
+  struct TapeWriter *Writer;    /* Write-behind queue of F or NULL          */
+  TapeFile *Files;              /* Index of the files or NULL               */
+  int FileCount;                /* Number of files in the index             */
+  int Indexed;                  /* 1 if the index matches the image         */
+};
+
+/****************************************************************************/
+/*** Open a tape image on an open file, which is taken over. A read-only  ***/
+/*** image is memory mapped where possible, anything else is read into    ***/
+/*** memory and written behind. A gzip compressed image is unpacked and   ***/
+/*** opened read-only, whatever readOnly says; see ReadOnly. Returns NULL ***/
+/*** in case of a failure                                                 ***/
+/****************************************************************************/
+Tape *Tape_OpenFile(FILE *F, int readOnly);
+
+/****************************************************************************/
+/*** Open a tape image on a copy of size bytes of data, e.g. from an      ***/
+/*** archive. Writes only change the copy. Gzip compressed data is        ***/
+/*** unpacked and opened read-only. Returns NULL in case of a failure     ***/
+/****************************************************************************/
+Tape *Tape_OpenMemory(const void *data, long size, int readOnly);
+
+/****************************************************************************/
+/*** Open a writable copy-on-write image on top of a base image. Blocks   ***/
+/*** written are stored in the overlay file F, which is taken over, and   ***/
+/*** are merged with the base image when the overlay is opened again. An  ***/
+/*** empty file is started afresh, anything else that isn't an overlay    ***/
+/*** of this base image fails and is left as it is. The base image is     ***/
+/*** closed, unless NULL is returned in case of a failure                 ***/
+/****************************************************************************/
+Tape *Tape_OpenOverlay(Tape *Base, FILE *F);
+
+/****************************************************************************/
+/*** Move to a position, at most the image size. Returns 0 if it is out   ***/
+/*** of range, leaving the position as it is                              ***/
+/****************************************************************************/
+int Tape_Seek(Tape *T, long pos);
+
+/****************************************************************************/
+/*** Return n bytes at the tape position and move past them. If fewer     ***/
+/*** bytes are left, move to the end and return NULL                      ***/
+/****************************************************************************/
+const byte *Tape_Read(Tape *T, long n);
+
+/****************************************************************************/
+/*** Write n bytes at the tape position, growing the image if needed.     ***/
+/*** Returns 0 in case of a failure                                       ***/
+/****************************************************************************/
+int Tape_Write(Tape *T, const byte *buf, long n);
+
+/****************************************************************************/
+/*** Cut the image off at the tape position. Returns 0 on a failure       ***/
+/****************************************************************************/
+int Tape_Truncate(Tape *T);
+
+/****************************************************************************/
+/*** Make the bytes written so far durable, i.e. flush them to the disk.  ***/
+/*** Writes to a file are done behind, by a writer thread, so this only   ***/
+/*** waits until they are done when wait is set. Returns 0 if a write     ***/
+/*** failed. Closing the tape waits for the writes as well                ***/
+/****************************************************************************/
+int Tape_Flush(Tape *T, int wait);
+
+/****************************************************************************/
+/*** Return the number of complete blocks on the tape                     ***/
+/****************************************************************************/
+long Tape_Blocks(const Tape *T);
+
+/****************************************************************************/
+/*** Move to the start of a block, or the end of the last one. Returns 0  ***/
+/*** if there is no such block                                            ***/
+/****************************************************************************/
+int Tape_SeekBlock(Tape *T, long block);
+
+/****************************************************************************/
+/*** Return the 32 byte P2000 header of a block or NULL                   ***/
+/****************************************************************************/
+const byte *Tape_Header(const Tape *T, long block);
+
+/****************************************************************************/
+/*** Return the files on the tape and their number in *count. The index   ***/
+/*** is built when the tape is opened and again after it is written to.   ***/
+/*** Returns NULL if the tape is empty or the index can't be allocated    ***/
+/****************************************************************************/
+const TapeFile *Tape_Files(Tape *T, int *count);
+
+/****************************************************************************/
+/*** Return the index of the first file with a description (and, if ext   ***/
+/*** isn't NULL, an extension) matching regardless of case, or -1         ***/
+/****************************************************************************/
+int Tape_FindFile(Tape *T, const char *name, const char *ext);
+
+/****************************************************************************/
+/*** Close the image and free the tape                                    ***/
+/****************************************************************************/
+void Tape_Close(Tape *T);
+
+#endif /* _TAPE_H */
@@ -0,0 +1,537 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the cassette library. A scan walks the folder, keeps
+// the entries of the index whose size and modification time still match
+// and hands the other images out to worker threads, which take the next
+// one from a shared counter, so a few large images don't hold up the rest.
+// The index file is plain text, a line per image followed by a line per
+// file on it, and is written to a temporary file first so it is never
+// left half written
+
+#include "TapeLib.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <pthread.h>
+#endif
+
+#define INDEX_MAGIC "M2000 cassette index 1"
+#define MAX_LINE    4096        /* Longest line in the index file           */
+#define MAX_DEPTH   16          /* Deepest subfolder scanned                */
+#define MAX_THREADS 64          /* Most worker threads                      */
+
+/** TapeLibScan **********************************************************/
+/** The images a scan reads and the next one for a worker to take       **/
+/*************************************************************************/
+typedef struct
+{
+  TapeLib *L;
+  int *Jobs;                    /* Entries to read                          */
+  int JobCount;                 /* Number of jobs                           */
+  atomic_int Next;              /* Next job to take                         */
+} TapeLibScan;
+
+/****************************************************************************/
+/*** Return a copy of a string or NULL                                    ***/
+/****************************************************************************/
+static char *Copy(const char *s)
+{
+  char *p = malloc(strlen(s) + 1);
+  return p ? strcpy(p, s) : NULL;
+}
+
+/****************************************************************************/
+/*** Return folder/path in a new string or NULL                           ***/
+/****************************************************************************/
+static char *Join(const char *folder, const char *path)
+{
+  char *p;
+
+  if (!*path)
+    return Copy(folder);
+  if (!*folder)
+    return Copy(path);
+  if ((p = malloc(strlen(folder) + strlen(path) + 2)))
+    sprintf(p, "%s/%s", folder, path);
+  return p;
+}
+
+/****************************************************************************/
+/*** Return 1 if a name ends in ext, which is lower case, in any case     ***/
+/****************************************************************************/
+static int EndsWith(const char *name, const char *ext)
+{
+  size_t n = strlen(name), m = strlen(ext);
+
+  if (n <= m)
+    return 0;
+  for (name += n - m; *ext && tolower((byte)*name) == *ext; ++name, ++ext);
+  return !*ext;
+}
+
+/****************************************************************************/
+/*** Free the path and files of an entry                                  ***/
+/****************************************************************************/
+static void FreeEntry(TapeLibEntry *E)
+{
+  free(E->Path);
+  free(E->Files);
+  E->Path = NULL;
+  E->Files = NULL;
+  E->FileCount = 0;
+}
+
+/****************************************************************************/
+/*** Add an entry to an array of n, growing it in steps. Returns a zeroed ***/
+/*** entry or NULL if memory runs out                                     ***/
+/****************************************************************************/
+static TapeLibEntry *AddEntry(TapeLibEntry **entries, int *n)
+{
+  TapeLibEntry *E;
+
+  if (!(*n & 255)) {
+    if (!(E = realloc(*entries, (*n + 256) * sizeof(TapeLibEntry))))
+      return NULL;
+    *entries = E;
+  }
+  E = *entries + (*n)++;
+  memset(E, 0, sizeof(TapeLibEntry));
+  E->Duplicate = -1;
+  return E;
+}
+
+static int ByPath(const void *a, const void *b)
+{
+  return strcmp(((const TapeLibEntry *)a)->Path, ((const TapeLibEntry *)b)->Path);
+}
+
+/****************************************************************************/
+/*** Split a line of the index at its tabs into at most n fields, the     ***/
+/*** last one running to the end of the line. Returns the number found    ***/
+/****************************************************************************/
+static int Split(char *line, char **field, int n)
+{
+  int i;
+
+  line[strcspn(line, "\r\n")] = '\0';
+  for (i = 0; i < n; ++i) {
+    field[i] = line;
+    if (i < n - 1) {
+      if (!(line = strchr(line, '\t')))
+        return i + 1;
+      *line++ = '\0';
+    }
+  }
+  return n;
+}
+
+/****************************************************************************/
+/*** Read the index file into the library. Parsing stops at the first     ***/
+/*** line that doesn't fit, keeping the entries before it                 ***/
+/****************************************************************************/
+static void Load(TapeLib *L)
+{
+  static char line[MAX_LINE];
+  char *f[8];
+  TapeLibEntry *E = NULL;
+  TapeFile *F;
+  FILE *in;
+  int max = 0;
+
+  if (!(in = fopen(L->Index, "r")))
+    return;
+  if (fgets(line, sizeof(line), in) && !strncmp(line, INDEX_MAGIC, strlen(INDEX_MAGIC)))
+    while (fgets(line, sizeof(line), in)) {
+      if (line[0] != '\t') {
+        // size, time, hash, blocks, files and path of an image
+        if (Split(line, f, 6) < 6 || !*f[5] || !(E = AddEntry(&L->Entries, &L->Count)))
+          break;
+        E->Size = strtol(f[0], NULL, 10);
+        E->Time = strtoll(f[1], NULL, 10);
+        E->Hash = strtoull(f[2], NULL, 16);
+        E->Blocks = strtol(f[3], NULL, 10);
+        E->FileCount = atoi(f[4]);
+        E->Status = E->Blocks < 0 ? TAPELIB_FAILED : TAPELIB_KEPT;
+        if (!(E->Path = Copy(f[5])) || E->FileCount < 0 ||
+            (E->FileCount && !(E->Files = calloc(E->FileCount, sizeof(TapeFile))))) {
+          FreeEntry(E);
+          --L->Count;
+          break;
+        }
+        max = E->FileCount;
+        E->FileCount = 0;
+      } else {
+        // block, blocks, address, length, type, extension and name of a
+        // file on the image above
+        if (!E || E->FileCount >= max || Split(line + 1, f, 7) < 7)
+          break;
+        F = E->Files + E->FileCount++;
+        F->Block = strtol(f[0], NULL, 10);
+        F->Blocks = strtol(f[1], NULL, 10);
+        F->Addr = strtol(f[2], NULL, 16);
+        F->Length = strtol(f[3], NULL, 10);
+        F->Type = strtol(f[4], NULL, 16);
+        strncpy(F->Ext, f[5], sizeof(F->Ext) - 1);
+        strncpy(F->Name, f[6], sizeof(F->Name) - 1);
+      }
+    }
+  fclose(in);
+  qsort(L->Entries, L->Count, sizeof(TapeLibEntry), ByPath);
+}
+
+/****************************************************************************/
+/*** Open the library of a folder and load its index                      ***/
+/****************************************************************************/
+TapeLib *TapeLib_Open(const char *folder, const char *index)
+{
+  TapeLib *L;
+
+  if (!(L = calloc(1, sizeof(TapeLib))))
+    return NULL;
+  L->Folder = Copy(folder);
+  L->Index = index ? Copy(index) : Join(folder, TAPELIB_INDEX);
+  if (!L->Folder || !L->Index) {
+    TapeLib_Close(L);
+    return NULL;
+  }
+  Load(L);
+  return L;
+}
+
+/****************************************************************************/
+/*** Add the tape images in a subfolder and its subfolders to found.      ***/
+/*** Hidden files and names the index can't hold are skipped. Returns 0   ***/
+/*** if the folder can't be read or memory runs out                       ***/
+/****************************************************************************/
+static int Walk(TapeLib *L, const char *sub, int depth, TapeLibEntry **found, int *n)
+{
+  struct dirent *d;
+  struct stat st;
+  TapeLibEntry *E;
+  char *path, *full;
+  DIR *dir;
+  int ok = 1;
+
+  if (!(full = Join(L->Folder, sub)))
+    return 0;
+  dir = opendir(full);
+  free(full);
+  if (!dir)
+    return 0;
+  while (ok && (d = readdir(dir))) {
+    if (d->d_name[0] == '.' || strpbrk(d->d_name, "\t\r\n"))
+      continue;
+    if (!(path = Join(sub, d->d_name)) || !(full = Join(L->Folder, path))) {
+      free(path);
+      ok = 0;
+      break;
+    }
+    if (!stat(full, &st)) {
+      if (S_ISDIR(st.st_mode) && depth < MAX_DEPTH)
+        Walk(L, path, depth + 1, found, n);
+      else if (S_ISREG(st.st_mode) && strlen(path) < MAX_LINE - 64 &&
+               (EndsWith(d->d_name, ".cas") || EndsWith(d->d_name, ".cas.gz"))) {
+        if ((E = AddEntry(found, n))) {
+          E->Path = path;
+          E->Size = st.st_size;
+          E->Time = st.st_mtime;
+          path = NULL;
+        } else
+          ok = 0;
+      }
+    }
+    free(full);
+    free(path);
+  }
+  closedir(dir);
+  return ok;
+}
+
+/****************************************************************************/
+/*** Read an image: hash it and take the files from its block headers     ***/
+/****************************************************************************/
+static void ReadEntry(TapeLib *L, TapeLibEntry *E)
+{
+  const TapeFile *F;
+  unsigned long long h = 14695981039346656037ull; // FNV-1a
+  FILE *In = NULL;
+  const byte *p;
+  char *full;
+  Tape *T;
+  char *q;
+  long n;
+  int count, i;
+
+  E->Hash = 0;
+  E->Blocks = -1;
+  free(E->Files);
+  E->Files = NULL;
+  E->FileCount = 0;
+  if ((full = Join(L->Folder, E->Path)))
+    In = fopen(full, "rb");
+  free(full);
+  T = In ? Tape_OpenFile(In, 1) : NULL;
+  if (!T) {
+    E->Status = TAPELIB_FAILED;
+    return;
+  }
+  for (p = T->Data, n = T->Size; n--; )
+    h = (h ^ *p++) * 1099511628211ull;
+  E->Hash = h;
+  E->Blocks = Tape_Blocks(T);
+  if ((F = Tape_Files(T, &count)) && (E->Files = malloc(count * sizeof(TapeFile)))) {
+    memcpy(E->Files, F, count * sizeof(TapeFile));
+    E->FileCount = count;
+    // the index separates fields by tabs and entries by newlines
+    for (i = 0; i < count; ++i) {
+      for (q = E->Files[i].Name; *q; ++q)
+        if ((byte)*q < ' ') *q = ' ';
+      for (q = E->Files[i].Ext; *q; ++q)
+        if ((byte)*q < ' ') *q = ' ';
+    }
+  }
+  Tape_Close(T);
+}
+
+/****************************************************************************/
+/*** Worker thread: read images until there are none left                 ***/
+/****************************************************************************/
+#if defined(_WIN32)
+static DWORD WINAPI Worker(LPVOID arg)
+#else
+static void *Worker(void *arg)
+#endif
+{
+  TapeLibScan *S = arg;
+  int j;
+
+  while ((j = atomic_fetch_add(&S->Next, 1)) < S->JobCount)
+    ReadEntry(S->L, S->L->Entries + S->Jobs[j]);
+  return 0;
+}
+
+/****************************************************************************/
+/*** Read the images of the jobs on up to threads threads. The calling    ***/
+/*** thread is one of them, and does all the work if none can be started  ***/
+/****************************************************************************/
+static void RunJobs(TapeLibScan *S, int threads)
+{
+#if defined(_WIN32)
+  HANDLE thread[MAX_THREADS];
+#elif !defined(__EMSCRIPTEN__)
+  pthread_t thread[MAX_THREADS];
+#endif
+  int i, n = 0;
+
+  if (threads > S->JobCount) threads = S->JobCount;
+  if (threads > MAX_THREADS) threads = MAX_THREADS;
+#if defined(_WIN32)
+  for (i = 1; i < threads; ++i)
+    if ((thread[n] = CreateThread(NULL, 0, Worker, S, 0, NULL)))
+      ++n;
+#elif !defined(__EMSCRIPTEN__)
+  for (i = 1; i < threads; ++i)
+    if (!pthread_create(&thread[n], NULL, Worker, S))
+      ++n;
+#endif
+  Worker(S);
+  for (i = 0; i < n; ++i) {
+#if defined(_WIN32)
+    WaitForSingleObject(thread[i], INFINITE);
+    CloseHandle(thread[i]);
+#elif !defined(__EMSCRIPTEN__)
+    pthread_join(thread[i], NULL);
+#endif
+  }
+}
+
+/****************************************************************************/
+/*** Mark each entry with the same tape as one before it as a duplicate   ***/
+/*** of the first of them                                                 ***/
+/****************************************************************************/
+static TapeLibEntry *SortEntries;
+static int ByHash(const void *a, const void *b)
+{
+  const TapeLibEntry *A = SortEntries + *(const int *)a;
+  const TapeLibEntry *B = SortEntries + *(const int *)b;
+  if (A->Hash != B->Hash) return A->Hash < B->Hash ? -1 : 1;
+  if (A->Blocks != B->Blocks) return A->Blocks < B->Blocks ? -1 : 1;
+  return *(const int *)a - *(const int *)b;
+}
+
+static int SameTape(const TapeLibEntry *A, const TapeLibEntry *B)
+{
+  return A->Hash == B->Hash && A->Blocks == B->Blocks;
+}
+
+static void FindDuplicates(TapeLib *L)
+{
+  int *order, i, j, n;
+
+  for (i = 0; i < L->Count; ++i)
+    L->Entries[i].Duplicate = -1;
+  if (!(order = malloc((L->Count + 1) * sizeof(int))))
+    return;
+  for (i = n = 0; i < L->Count; ++i)
+    if (L->Entries[i].Status != TAPELIB_FAILED)
+      order[n++] = i;
+  // the library is scanned by one thread at a time
+  SortEntries = L->Entries;
+  qsort(order, n, sizeof(int), ByHash);
+  for (i = 0; i < n; i = j)
+    for (j = i + 1; j < n && SameTape(L->Entries + order[i], L->Entries + order[j]); ++j)
+      L->Entries[order[j]].Duplicate = order[i];
+  free(order);
+}
+
+/****************************************************************************/
+/*** Bring the library up to date with the folder                         ***/
+/****************************************************************************/
+int TapeLib_Scan(TapeLib *L, int threads)
+{
+  TapeLibEntry *found = NULL, *E, *old;
+  TapeLibScan S;
+  int i, j, n = 0, c = 1;
+
+  if (!Walk(L, "", 0, &found, &n)) {
+    for (i = 0; i < n; ++i)
+      FreeEntry(found + i);
+    free(found);
+    return -1;
+  }
+  qsort(found, n, sizeof(TapeLibEntry), ByPath);
+  if (!(S.Jobs = malloc((n + 1) * sizeof(int)))) {
+    for (i = 0; i < n; ++i)
+      FreeEntry(found + i);
+    free(found);
+    return -1;
+  }
+  // both lists are sorted by path: keep the entries that didn't change
+  S.L = L;
+  S.JobCount = 0;
+  atomic_init(&S.Next, 0);
+  L->Removed = 0;
+  for (i = j = 0; i < n; ++i) {
+    E = found + i;
+    while (j < L->Count && (c = strcmp(L->Entries[j].Path, E->Path)) < 0) {
+      FreeEntry(L->Entries + j++);
+      ++L->Removed;
+    }
+    old = j < L->Count && !c ? L->Entries + j++ : NULL;
+    // an image that failed is read again, the failure may have passed
+    if (old && old->Size == E->Size && old->Time == E->Time && old->Blocks >= 0) {
+      free(E->Path);
+      *E = *old;
+      E->Status = TAPELIB_KEPT;
+      old->Path = NULL;
+      old->Files = NULL;
+    } else {
+      E->Status = old ? TAPELIB_CHANGED : TAPELIB_ADDED;
+      S.Jobs[S.JobCount++] = i;
+      if (old) FreeEntry(old);
+    }
+  }
+  for (; j < L->Count; ++j) {
+    FreeEntry(L->Entries + j);
+    ++L->Removed;
+  }
+  free(L->Entries);
+  L->Entries = found;
+  L->Count = n;
+  RunJobs(&S, threads < 1 ? 1 : threads);
+  free(S.Jobs);
+  FindDuplicates(L);
+  return S.JobCount;
+}
+
+/****************************************************************************/
+/*** Write the index file                                                 ***/
+/****************************************************************************/
+int TapeLib_Save(TapeLib *L)
+{
+  const TapeLibEntry *E;
+  const TapeFile *F;
+  char *tmp;
+  FILE *out;
+  int i, j, ok;
+
+  if (!(tmp = malloc(strlen(L->Index) + 5)))
+    return 0;
+  sprintf(tmp, "%s.tmp", L->Index);
+  if (!(out = fopen(tmp, "w"))) {
+    free(tmp);
+    return 0;
+  }
+  fprintf(out, "%s\n", INDEX_MAGIC);
+  for (i = 0; i < L->Count; ++i) {
+    E = L->Entries + i;
+    fprintf(out, "%ld\t%lld\t%016llx\t%ld\t%d\t%s\n",
+            E->Size, E->Time, E->Hash, E->Blocks, E->FileCount, E->Path);
+    for (j = 0, F = E->Files; j < E->FileCount; ++j, ++F)
+      fprintf(out, "\t%ld\t%ld\t%04X\t%u\t%02X\t%s\t%s\n",
+              F->Block, F->Blocks, F->Addr, F->Length, (byte)F->Type, F->Ext, F->Name);
+  }
+  ok = !ferror(out);
+  ok = !fclose(out) && ok;
+  // rename() doesn't replace an existing file on Windows
+  if (ok) {
+    remove(L->Index);
+    ok = !rename(tmp, L->Index);
+  }
+  if (!ok)
+    remove(tmp);
+  free(tmp);
+  return ok;
+}
+
+/****************************************************************************/
+/*** Return the title of an entry                                         ***/
+/****************************************************************************/
+const char *TapeLib_Title(const TapeLibEntry *E)
+{
+  const char *p;
+
+  if (E->FileCount && E->Files[0].Name[0])
+    return E->Files[0].Name;
+  return (p = strrchr(E->Path, '/')) ? p + 1 : E->Path;
+}
+
+/****************************************************************************/
+/*** Free the library                                                     ***/
+/****************************************************************************/
+void TapeLib_Close(TapeLib *L)
+{
+  int i;
+
+  if (!L)
+    return;
+  for (i = 0; i < L->Count; ++i)
+    FreeEntry(L->Entries + i);
+  free(L->Entries);
+  free(L->Folder);
+  free(L->Index);
+  free(L);
+}
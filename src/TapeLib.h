@@ -0,0 +1,104 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the cassette library: an index of the tape images in
+// a folder and its subfolders. Every image is hashed and its block headers
+// are parsed into the same file list the emulator shows, and the result is
+// kept in an index file. A rescan only reads the images that are new, that
+// failed before or whose size or modification time changed, spread over
+// worker threads.
+// Images with the same hash hold the same tape, however they are named or
+// compressed, so duplicates are found by comparing hashes
+
+#ifndef _TAPELIB_H
+#define _TAPELIB_H
+
+#include "Tape.h"
+
+#define TAPELIB_INDEX    "M2000.idx" /* Index file name in the folder   */
+#define TAPELIB_THREADS  4           /* Worker threads by default       */
+
+enum
+{
+  TAPELIB_KEPT,                 /* Unchanged since the index was saved      */
+  TAPELIB_ADDED,                /* Not in the index                         */
+  TAPELIB_CHANGED,              /* Changed, or failed before: read again    */
+  TAPELIB_FAILED                /* Could not be read as a tape image        */
+};
+
+/** TapeLibEntry *********************************************************/
+/** A tape image in the library and the files on it                     **/
+/*************************************************************************/
+typedef struct
+{
+  char *Path;                   /* Relative to the folder, '/' separated    */
+  long Size;                    /* File size                                */
+  long long Time;               /* Modification time                        */
+  unsigned long long Hash;      /* FNV-1a of the image, unpacked            */
+  long Blocks;                  /* Number of blocks                         */
+  TapeFile *Files;              /* Files on the tape or NULL                */
+  int FileCount;                /* Number of files                          */
+  int Status;                   /* TAPELIB_KEPT, ... of the last scan       */
+  int Duplicate;                /* Entry with the same tape before it or -1 */
+} TapeLibEntry;
+
+/** TapeLib **************************************************************/
+/** The library of a folder. Entries are sorted by path                 **/
+/*************************************************************************/
+typedef struct
+{
+  char *Folder;                 /* Folder scanned                           */
+  char *Index;                  /* Index file                               */
+  TapeLibEntry *Entries;        /* Tape images                              */
+  int Count;                    /* Number of entries                        */
+  int Removed;                  /* Entries gone since the index was saved   */
+} TapeLib;
+
+/****************************************************************************/
+/*** Open the library of a folder and load its index file, by default     ***/
+/*** TAPELIB_INDEX in the folder. A missing or unreadable index gives an  ***/
+/*** empty library. Returns NULL if memory runs out                       ***/
+/****************************************************************************/
+TapeLib *TapeLib_Open(const char *folder, const char *index);
+
+/****************************************************************************/
+/*** Bring the library up to date with the folder, reading new and        ***/
+/*** changed images on up to threads worker threads, and find the         ***/
+/*** duplicates. Returns the number of images read or -1 if the folder    ***/
+/*** can't be read                                                        ***/
+/****************************************************************************/
+int TapeLib_Scan(TapeLib *L, int threads);
+
+/****************************************************************************/
+/*** Write the index file. Returns 0 in case of a failure                 ***/
+/****************************************************************************/
+int TapeLib_Save(TapeLib *L);
+
+/****************************************************************************/
+/*** Return the title of an entry: the description of its first file, or  ***/
+/*** the file name without the folder if the tape is empty                ***/
+/****************************************************************************/
+const char *TapeLib_Title(const TapeLibEntry *E);
+
+/****************************************************************************/
+/*** Free the library                                                     ***/
+/****************************************************************************/
+void TapeLib_Close(TapeLib *L);
+
+#endif /* _TAPELIB_H */
@@ -0,0 +1,216 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the WAV writer. The emulation thread only appends
+// samples to an audio ring; a writer thread polls the ring every few
+// milliseconds and converts the samples to little endian for the file.
+// Without threads (Emscripten), the samples are written right away
+
+#include "WavWriter.h"
+#include "AudioRing.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define THREAD_TYPE HANDLE
+#elif !defined(__EMSCRIPTEN__)
+#include <pthread.h>
+#include <time.h>
+#define THREAD_TYPE pthread_t
+#endif
+
+#define WAV_HEADER_SIZE 44
+#define WAV_CHUNK       1024  /* Samples converted at a time            */
+#define WAV_POLL_MS     10    /* Writer thread sleep when idle          */
+
+struct WavWriter
+{
+  FILE *F;                    /* Output file                            */
+  int Rate;                   /* Sample rate                            */
+  unsigned long Samples;      /* Samples written to the file            */
+  int Error;                  /* 1 if writing failed                    */
+  int Dropped;                /* 1 if samples didn't fit in the ring    */
+  AudioRing Ring;             /* Samples waiting for the writer thread  */
+#ifdef THREAD_TYPE
+  THREAD_TYPE Thread;         /* Writer thread                          */
+  atomic_int Stop;            /* Set to make the writer thread finish   */
+#endif
+};
+
+static void PutLong(unsigned char *p, unsigned long v)
+{
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+/****************************************************************************/
+/*** Write a WAV header for the given number of samples                   ***/
+/****************************************************************************/
+static int WriteHeader(WavWriter *W)
+{
+  unsigned char H[WAV_HEADER_SIZE] =
+    "RIFF\0\0\0\0WAVEfmt \20\0\0\0\1\0\1\0\0\0\0\0\0\0\0\0\2\0\20\0data";
+
+  PutLong(H + 4, 36 + 2 * W->Samples);
+  PutLong(H + 24, W->Rate);
+  PutLong(H + 28, 2 * W->Rate);
+  PutLong(H + 40, 2 * W->Samples);
+  return fwrite(H, 1, WAV_HEADER_SIZE, W->F) == WAV_HEADER_SIZE;
+}
+
+/****************************************************************************/
+/*** Convert samples to little endian and write them                      ***/
+/****************************************************************************/
+static void WriteSamples(WavWriter *W, const short *buf, int n)
+{
+  unsigned char B[2 * WAV_CHUNK];
+  int i, m;
+
+  for (; n > 0; n -= m, buf += m) {
+    m = n < WAV_CHUNK ? n : WAV_CHUNK;
+    for (i = 0; i < m; ++i) {
+      B[2 * i] = buf[i];
+      B[2 * i + 1] = buf[i] >> 8;
+    }
+    if (fwrite(B, 2, m, W->F) != (size_t)m)
+      W->Error = 1;
+    W->Samples += m;
+  }
+}
+
+#ifdef THREAD_TYPE
+static void Sleep_ms(int ms)
+{
+#ifdef _WIN32
+  Sleep(ms);
+#else
+  struct timespec t = { ms / 1000, (ms % 1000) * 1000000L };
+  nanosleep(&t, NULL);
+#endif
+}
+
+/****************************************************************************/
+/*** The writer thread empties the ring until it is told to stop          ***/
+/****************************************************************************/
+#ifdef _WIN32
+static DWORD WINAPI WriterThread(LPVOID arg)
+#else
+static void *WriterThread(void *arg)
+#endif
+{
+  WavWriter *W = arg;
+  short buf[WAV_CHUNK];
+  int stop, n;
+
+  do {
+    // look at the flag first, so the last samples are always written
+    stop = atomic_load(&W->Stop);
+    while ((n = AudioRing_Read(&W->Ring, buf, WAV_CHUNK)) > 0)
+      WriteSamples(W, buf, n);
+    if (!stop)
+      Sleep_ms(WAV_POLL_MS);
+  } while (!stop);
+  return 0;
+}
+#endif /* THREAD_TYPE */
+
+/****************************************************************************/
+/*** Create a WAV file and start its writer thread                        ***/
+/****************************************************************************/
+WavWriter *WavWriter_Open(const char *filename, int rate)
+{
+  WavWriter *W;
+
+  if (!(W = calloc(1, sizeof(WavWriter))))
+    return NULL;
+  W->Rate = rate;
+  if (!AudioRing_Init(&W->Ring, rate * WAVWRITER_SECONDS, 0)) {
+    free(W);
+    return NULL;
+  }
+  if (!(W->F = fopen(filename, "wb")) || !WriteHeader(W)) {
+    if (W->F) fclose(W->F);
+    AudioRing_Trash(&W->Ring);
+    free(W);
+    return NULL;
+  }
+#ifdef THREAD_TYPE
+  atomic_init(&W->Stop, 0);
+#ifdef _WIN32
+  W->Thread = CreateThread(NULL, 0, WriterThread, W, 0, NULL);
+  if (!W->Thread) {
+#else
+  if (pthread_create(&W->Thread, NULL, WriterThread, W)) {
+#endif
+    fclose(W->F);
+    AudioRing_Trash(&W->Ring);
+    free(W);
+    return NULL;
+  }
+#endif
+  return W;
+}
+
+/****************************************************************************/
+/*** Queue samples for the writer thread                                  ***/
+/****************************************************************************/
+int WavWriter_Write(WavWriter *W, const short *buf, int n, int wait)
+{
+#ifdef THREAD_TYPE
+  int done = AudioRing_Write(&W->Ring, buf, n);
+
+  while (wait && done < n) {
+    Sleep_ms(1);
+    done += AudioRing_Write(&W->Ring, buf + done, n - done);
+  }
+  if (done < n)
+    W->Dropped = 1;
+  return done;
+#else
+  WriteSamples(W, buf, n);
+  return n;
+#endif
+}
+
+/****************************************************************************/
+/*** Stop the writer thread and complete the file                         ***/
+/****************************************************************************/
+int WavWriter_Close(WavWriter *W)
+{
+  int ok;
+
+#ifdef THREAD_TYPE
+  atomic_store(&W->Stop, 1);
+#ifdef _WIN32
+  WaitForSingleObject(W->Thread, INFINITE);
+  CloseHandle(W->Thread);
+#else
+  pthread_join(W->Thread, NULL);
+#endif
+#endif
+  // fill in the sizes; this fails harmlessly when writing to a pipe
+  if (!fseek(W->F, 0, SEEK_SET) && !WriteHeader(W))
+    W->Error = 1;
+  if (fclose(W->F))
+    W->Error = 1;
+  ok = !W->Error && !W->Dropped;
+  AudioRing_Trash(&W->Ring);
+  free(W);
+  return ok;
+}
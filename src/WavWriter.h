@@ -0,0 +1,52 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the WAV writer, which records 16 bit mono samples to
+// a WAV file. The samples are passed through an audio ring to a writer
+// thread, so the emulation never waits for the disk. The sizes in the
+// header are filled in when the file is closed
+
+#ifndef _WAVWRITER_H
+#define _WAVWRITER_H
+
+#define WAVWRITER_SECONDS 4 /* Samples buffered for the writer thread   */
+
+typedef struct WavWriter WavWriter;
+
+/****************************************************************************/
+/*** Create a WAV file with the given sample rate and start its writer    ***/
+/*** thread. Returns NULL in case of a failure                            ***/
+/****************************************************************************/
+WavWriter *WavWriter_Open(const char *filename, int rate);
+
+/****************************************************************************/
+/*** Queue n samples. When the buffer is full, the samples that don't     ***/
+/*** fit are dropped, or, if wait is set, it waits for the writer thread  ***/
+/*** to make room; for recordings that are not synced to real time.       ***/
+/*** Returns the number of samples queued                                 ***/
+/****************************************************************************/
+int WavWriter_Write(WavWriter *W, const short *buf, int n, int wait);
+
+/****************************************************************************/
+/*** Write the queued samples, complete the header and close the file.    ***/
+/*** Returns 0 if writing failed or samples were dropped                  ***/
+/****************************************************************************/
+int WavWriter_Close(WavWriter *W);
+
+#endif /* _WAVWRITER_H */
@@ -37,10 +37,13 @@ extern byte *ReadPage[256];
 #define Z80_RDMEM(a) ReadPage[(a)>>8][(a)&0xFF]
 
 /****************************************************************************/
-/* Write a byte to given memory location                                    */
+/* Write a byte to given memory location. Pages without a write pointer are */
+/* handled by Z80_WrPage()                                                  */
 /****************************************************************************/
 extern byte *WritePage[256];
-#define Z80_WRMEM(a,v) WritePage[(a)>>8][(a)&0xFF]=v
+void Z80_WrPage (dword a,byte v);
+#define Z80_WRMEM(a,v) do { byte *_P=WritePage[(a)>>8]; \
+                            if (_P) _P[(a)&0xFF]=v; else Z80_WrPage(a,v); } while (0)
 
 /****************************************************************************/
 /* Since the P2000 doesn't use memory mapped I/O nor opcode encryption, we  */
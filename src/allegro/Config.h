@@ -38,10 +38,17 @@ void ParseConfig()
   PrnType         = atoi(al_get_config_value(config, "Hardware",  "printertype"));
   ROMName         =      al_get_config_value(config, "Hardware",  "romfile");
   FontName        =      al_get_config_value(config, "Hardware",  "font");
+  P2000Model      = strcmp(al_get_config_value(config, "Hardware",  "model"), "M") == 0 ? P2000_M : P2000_T;
 
   TapeName        =      al_get_config_value(config, "File",      "tape");
   CartName        =      al_get_config_value(config, "File",      "cart");
   PrnName         =      al_get_config_value(config, "File",      "printer");
+  CaptureName     = *al_get_config_value(config, "File",      "capture") ?
+                         al_get_config_value(config, "File",      "capture") : NULL;
+  RemoteName      = *al_get_config_value(config, "File",      "remote") ?
+                         al_get_config_value(config, "File",      "remote") : NULL;
+  WavName         = *al_get_config_value(config, "File",      "wav") ?
+                         al_get_config_value(config, "File",      "wav") : NULL;
   userCassettesPath = al_create_path_for_directory(al_get_config_value(config, "File", "cassettes"));
   userCartridgesPath = al_create_path_for_directory(al_get_config_value(config, "File", "cartridges"));
   userScreenshotsPath = al_create_path_for_directory(al_get_config_value(config, "File", "screenshots"));
@@ -51,11 +58,16 @@ void ParseConfig()
   IFreq           = atoi(al_get_config_value(config, "Speed",     "ifreq"));
   CpuSpeed        = atoi(al_get_config_value(config, "Speed",     "cpuspeed"));
   Sync            = strcmp(al_get_config_value(config, "Speed",   "sync"), "on") == 0;
+  audiosync       = strcmp(al_get_config_value(config, "Speed",   "audiosync"), "on") == 0;
   UPeriod         = atoi(al_get_config_value(config, "Speed",     "uperiod"));
+  TapeLoadDelay   = atoi(al_get_config_value(config, "Speed",     "tapedelay"));
+  TapeTurbo       = strcmp(al_get_config_value(config, "Speed",   "tapeturbo"), "on") == 0;
 
   videomode       = atoi(al_get_config_value(config, "Display",   "video"));
   scanlines       = strcmp(al_get_config_value(config, "Display", "scanlines"), "on") == 0;
   smoothing       = strcmp(al_get_config_value(config, "Display", "smoothing"), "on") == 0;
+  renderthread    = strcmp(al_get_config_value(config, "Display", "renderthread"), "on") == 0;
+  RasterScreen    = strcmp(al_get_config_value(config, "Display", "raster"), "on") == 0;
 
   keyboardmap     = atoi(al_get_config_value(config, "Keyboard",   "keymap"));
 
@@ -85,17 +97,22 @@ void InitConfig()
   al_add_config_comment(config, "Hardware",   "                      1 - Matrix");
   al_add_config_comment(config, "Hardware",   "romfile=<file>        Set P2000 ROM file [P2000ROM.bin]");
   al_add_config_comment(config, "Hardware",   "font=<filename>       Set SAA5050 font to use [Default.fnt]");
+  al_add_config_comment(config, "Hardware",   "model=T|M             Emulate a P2000T or a P2000M (80 columns) [T]");
   al_set_config_value  (config, "Hardware",   "ram", "32");
   al_set_config_value  (config, "Hardware",   "boot", "on");
   al_set_config_value  (config, "Hardware",   "printertype", "0");
   al_set_config_value  (config, "Hardware",   "romfile", "P2000ROM.bin");
   al_set_config_value  (config, "Hardware",   "font", "Default.fnt");
+  al_set_config_value  (config, "Hardware",   "model", "T");
   al_add_config_comment(config, "Hardware",   "");
 
   /* File */
   al_add_config_comment(config, "File",       "tape=<filename>       Set tape image to use [Default.cas]");
   al_add_config_comment(config, "File",       "cart=<filename>       Set cartridge image to use [BASIC.bin]");
   al_add_config_comment(config, "File",       "printer=<filename>    Set file for printer output [Printer.out]");
+  al_add_config_comment(config, "File",       "capture=<filename>    Record the screen to a cell stream file, see capconv []");
+  al_add_config_comment(config, "File",       "remote=<socket>       Send the screen to viewers on a Unix domain socket, see m2view []");
+  al_add_config_comment(config, "File",       "wav=<filename>        Record the sound to a WAV file; turn sync off to record faster than real time []");
   al_add_config_comment(config, "File",       "cassettes=<path>      Set folder containing cassette files (.cas)");
   al_add_config_comment(config, "File",       "cartridges=<path>     Set folder containing cartridge files (.bin)");
   al_add_config_comment(config, "File",       "screenshots=<path>    Set folder to store the screenshot files (.bmp|.png)");
@@ -104,6 +121,9 @@ void InitConfig()
   al_set_config_value  (config, "File",       "tape", "Default.cas");
   al_set_config_value  (config, "File",       "cart", "BASIC.bin");
   al_set_config_value  (config, "File",       "printer", "Printer.out");
+  al_set_config_value  (config, "File",       "capture", "");
+  al_set_config_value  (config, "File",       "remote", "");
+  al_set_config_value  (config, "File",       "wav", "");
   ALLEGRO_PATH * _docPath = al_clone_path(docPath);
   al_set_path_filename(_docPath, NULL);
   al_append_path_component(_docPath, SUBDIR_CASSETTES);
@@ -124,12 +144,19 @@ void InitConfig()
   al_add_config_comment(config, "Speed",      "cpuspeed=<speed>      Set Z80 CPU speed [100]%");
   al_add_config_comment(config, "Speed",      "sync=on|off           Sync/Do not sync emulation [on]");
   al_add_config_comment(config, "Speed",      "                      Emulation will be too fast if sync is turned off");
+  al_add_config_comment(config, "Speed",      "audiosync=on|off      Sync to the sound card instead of a timer [off]");
   al_add_config_comment(config, "Speed",      "uperiod=<value>       Number of interrupts per screen update [1]");
   al_add_config_comment(config, "Speed",      "                      Try uperiod 2 or uperiod 3 if emulation is a bit slow");
+  al_add_config_comment(config, "Speed",      "tapedelay=<value>     Interrupts per line of a loading picture [10]");
+  al_add_config_comment(config, "Speed",      "                      0 - Load pictures instantly");
+  al_add_config_comment(config, "Speed",      "tapeturbo=on|off      Fast-forward programs with their own tape loader [on]");
   al_set_config_value  (config, "Speed",      "ifreq", "50");
   al_set_config_value  (config, "Speed",      "cpuspeed", "100");
   al_set_config_value  (config, "Speed",      "sync", "on");
+  al_set_config_value  (config, "Speed",      "audiosync", "off");
   al_set_config_value  (config, "Speed",      "uperiod", "1");
+  al_set_config_value  (config, "Speed",      "tapedelay", "10");
+  al_set_config_value  (config, "Speed",      "tapeturbo", "on");
   al_add_config_comment(config, "Speed",      "");
   
   /* Display */
@@ -143,9 +170,13 @@ void InitConfig()
   al_add_config_comment(config, "Display",    "                      99 - Full Screen (not supported on Linux)");
   al_add_config_comment(config, "Display",    "scanlines=on|off      Show/Do not show scanlines [off]");
   al_add_config_comment(config, "Display",    "smoothing=on|off      Use display smoothing [on]");
+  al_add_config_comment(config, "Display",    "renderthread=on|off   Draw the screen on a separate thread [on]");
+  al_add_config_comment(config, "Display",    "raster=on|off         Show screen changes made while the screen is drawn [on]");
   al_set_config_value  (config, "Display",    "video", "0");
   al_set_config_value  (config, "Display",    "scanlines", "off");
   al_set_config_value  (config, "Display",    "smoothing", "on");
+  al_set_config_value  (config, "Display",    "renderthread", "on");
+  al_set_config_value  (config, "Display",    "raster", "on");
   al_add_config_comment(config, "Display",    "");
 
   /* Keyboard */
@@ -212,6 +243,7 @@ void SaveConfig()
   if (sprintf(intstr, "%i", IFreq))         al_set_config_value(config, "Speed", "ifreq", intstr);
   if (sprintf(intstr, "%i", CpuSpeed))      al_set_config_value(config, "Speed", "cpuspeed", intstr);
   al_set_config_value(config, "Speed", "sync", Sync ? "on" : "off");
+  al_set_config_value(config, "Speed", "audiosync", audiosync ? "on" : "off");
   if (sprintf(intstr, "%i", UPeriod))       al_set_config_value(config, "Speed", "uperiod", intstr);
 
   if (sprintf(intstr, "%i", optimalVideomode == videomode ? 0 : videomode)) al_set_config_value(config, "Display", "video", intstr);
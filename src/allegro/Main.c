@@ -22,7 +22,7 @@
 #define CHAR_TILE_WIDTH (6*CHAR_PIXEL_WIDTH)
 #define CHAR_TILE_SPACE 3
 #define CHAR_TILE_HEIGHT (10*CHAR_PIXEL_HEIGHT)
-#define FONT_BITMAP_WIDTH (96+64+64)*(CHAR_TILE_WIDTH + CHAR_TILE_SPACE)
+#define FONT_BITMAP_WIDTH SAA5050_CHARS*(CHAR_TILE_WIDTH + CHAR_TILE_SPACE)
 
 #ifdef __APPLE__
 #define ALLEGRO_UNSTABLE // needed for al_clear_keyboard_state();
@@ -43,19 +43,85 @@
 #include <allegro5/allegro_native_dialog.h> 
 #include "../P2000.h"
 #include "../M2000.h"
+#include "../SAA5050.h"
+#include "../Beeper.h"
+#include "../AudioRing.h"
+#include "../WavWriter.h"
+#include "../TapeLib.h"
 #include "Main.h"
 #include "Keyboard.h"
 #include "Menu.h"
 #include "State.h"
 #include "Config.h"
 
+/****************************************************************************/
+/*** The audio thread fills every fragment the stream hands out with      ***/
+/*** samples from the ring, resampled to match the sound card's clock     ***/
+/****************************************************************************/
+void *AudioThread(ALLEGRO_THREAD *thread, void *arg)
+{
+  ALLEGRO_EVENT audioEvent;
+  short *fragment;
+
+  while (!al_get_thread_should_stop(thread)) {
+    // time out now and then to see if the thread should stop
+    if (!al_wait_for_event_timed(audioQueue, &audioEvent, 0.1))
+      continue;
+    if (audioEvent.type != ALLEGRO_EVENT_AUDIO_STREAM_FRAGMENT)
+      continue;
+    while ((fragment = al_get_audio_stream_fragment(stream))) {
+      AudioRing_Resample(&soundring, fragment, buf_size);
+      al_set_audio_stream_fragment(stream, fragment);
+    }
+    // wake up the emulation if it waits for room in the ring
+    al_lock_mutex(audioMutex);
+    al_signal_cond(audioCond);
+    al_unlock_mutex(audioMutex);
+  }
+  return NULL;
+}
+
+void CloseWav()
+{
+  if (!wav) return;
+  if (Verbose) printf("Closing sound capture %s...", WavName);
+  if (Verbose) puts(WavWriter_Close(wav) ? "OK" : "FAILED");
+  wav = NULL;
+}
+
+void StopAudioThread()
+{
+  if (audioThread) {
+    al_set_thread_should_stop(audioThread);
+    al_destroy_thread(audioThread); // waits for the thread to finish
+    audioThread = NULL;
+  }
+}
+
 /****************************************************************************/
 /*** Deallocate resources taken by InitMachine()                          ***/
 /****************************************************************************/
 void TrashMachine(void)
 {
   if (Verbose) printf("\n\nShutting down...\n");
+  if (renderThread) {
+    al_lock_mutex(renderMutex);
+    al_set_thread_should_stop(renderThread);
+    al_signal_cond(renderCond);
+    al_unlock_mutex(renderMutex);
+    al_destroy_thread(renderThread); // waits for the thread to finish
+  }
+  if (renderCond) al_destroy_cond(renderCond);
+  if (renderMutex) al_destroy_mutex(renderMutex);
+  if (displayMutex) al_destroy_mutex(displayMutex);
+  StopAudioThread();
+  CloseWav();
+  if (audioQueue) al_destroy_event_queue(audioQueue);
+  if (audioCond) al_destroy_cond(audioCond);
+  if (audioMutex) al_destroy_mutex(audioMutex);
   if (soundbuf) free (soundbuf);
+  AudioRing_Trash(&soundring);
+  Beeper_Trash();
   if (OldCharacter) free (OldCharacter);
 }
 
@@ -69,27 +135,54 @@ void ShowErrorMessage(const char *format, ...)
   al_show_native_message_box(NULL, Title, "", string, "", ALLEGRO_MESSAGEBOX_ERROR);
 }
 
+/****************************************************************************/
+/*** Make the display the drawing target of the calling thread. When the  ***/
+/*** render thread is running, only one thread at a time may hold it      ***/
+/****************************************************************************/
+void LockDisplay() 
+{
+  if (renderThread) al_lock_mutex(displayMutex);
+  al_set_target_backbuffer(display);
+}
+
+void UnlockDisplay() 
+{
+  if (renderThread) {
+    al_set_target_bitmap(NULL); // release the display for the other thread
+    al_unlock_mutex(displayMutex);
+  }
+}
+
 void ClearScreen() 
 {
-  al_set_target_bitmap(al_get_backbuffer(display));
+  LockDisplay();
   al_clear_to_color(al_map_rgb(0, 0, 0));
   memset(OldCharacter, -1, 80 * 24 * sizeof(int)); //clear old screen characters
+  UnlockDisplay();
 }
 
 void ResetAudioStream() 
 {
     if (Verbose) printf("  Creating the audio stream: ");
+    StopAudioThread();
     for (buf_size = 4096; buf_size >= 128; buf_size /= 2) if (buf_size * IFreq <= 44100) break;
+    // a WAV file can't change its sample rate halfway
+    if (wav && sample_rate != buf_size * IFreq) CloseWav();
     sample_rate = buf_size * IFreq;
     if (Verbose) printf("%d Hz, buffer size %d...", sample_rate, buf_size);
     if (soundbuf) free(soundbuf);
-    soundbuf = malloc(buf_size);
-    memset(soundbuf, 0, buf_size); //init sound buffer
+    soundbuf = calloc(buf_size, sizeof(short));
+    if (!Beeper_Init(buf_size)) soundDetected = 0;
+    // the ring keeps three interrupts of samples ahead of the stream; with
+    // less, the phase between both clocks slips before the rate reacts
+    AudioRing_Trash(&soundring);
+    if (!AudioRing_Init(&soundring, 8 * buf_size, 3 * buf_size)) soundDetected = 0;
     if (stream) {
+      if (audioQueue) al_unregister_event_source(audioQueue, al_get_audio_stream_event_source(stream));
       al_detach_audio_stream(stream);
       al_destroy_audio_stream(stream);
     }
-    stream = al_create_audio_stream(4, buf_size, sample_rate, ALLEGRO_AUDIO_DEPTH_INT8, ALLEGRO_CHANNEL_CONF_1);
+    stream = al_create_audio_stream(2, buf_size, sample_rate, ALLEGRO_AUDIO_DEPTH_INT16, ALLEGRO_CHANNEL_CONF_1);
     if (!stream || !soundbuf) {
       if (Verbose) puts("FAILED");
       soundDetected = 0;
@@ -104,6 +197,19 @@ void ResetAudioStream()
       soundDetected = 0;
     }
     else if (Verbose) puts("OK");
+
+    if (!soundDetected) return;
+    if (Verbose) printf("  Starting audio thread...");
+    if (!audioQueue) audioQueue = al_create_event_queue();
+    if (!audioMutex) audioMutex = al_create_mutex();
+    if (!audioCond) audioCond = al_create_cond();
+    if (audioQueue && audioMutex && audioCond) {
+      al_register_event_source(audioQueue, al_get_audio_stream_event_source(stream));
+      audioThread = al_create_thread(AudioThread, NULL);
+    }
+    if (audioThread) al_start_thread(audioThread);
+    else soundDetected = 0;
+    if (Verbose) puts(audioThread ? "OK" : "FAILED");
 }
 
 void UpdateWindowTitle() 
@@ -119,6 +225,7 @@ void ToggleFullscreen()
   return;
 #endif
   ClearScreen();
+  LockDisplay();
   if (al_get_display_flags(display) & ALLEGRO_FULLSCREEN_WINDOW) {
     //back to window mode
     UpdateDisplaySettings();
@@ -140,12 +247,13 @@ void ToggleFullscreen()
     DisplayWidth = DisplayHeight * 4 / 3;
     DisplayVBorder = (monitorInfo.y2 - monitorInfo.y1 - DisplayHeight) / 2;
     DisplayHBorder = (monitorInfo.x2 - monitorInfo.x1 - DisplayWidth) / 2;
-    DisplayTileWidth = DisplayWidth / 40;
+    DisplayTileWidth = DisplayWidth / P2000_COLUMNS;
     DisplayTileHeight = DisplayHeight / 24;
     if (Verbose) printf("Fullscreen resizing to %ix%i\n",DisplayWidth + 2*DisplayHBorder, DisplayHeight + 2*DisplayVBorder);
     al_resize_display(display, DisplayWidth + 2*DisplayHBorder, DisplayHeight + 2*DisplayVBorder);
     al_set_display_flag(display , ALLEGRO_FULLSCREEN_WINDOW , 1);
   }
+  UnlockDisplay();
 }
 
 int CopyFile(ALLEGRO_PATH *sourceFolder, const char * filename, ALLEGRO_PATH *destinationFolder) 
@@ -315,6 +423,11 @@ int InitMachine(void)
   soundDetected = al_install_audio() && al_reserve_samples(0);
   if (Verbose) puts(soundDetected ? "OK" :"FAILED");
   ResetAudioStream();
+  if (WavName) {
+    if (Verbose) printf("Opening sound capture %s...", WavName);
+    wav = WavWriter_Open(WavName, sample_rate);
+    if (Verbose) puts(wav ? "OK" : "FAILED");
+  }
 
   // create menu
   if (Verbose) printf("Creating menu...");
@@ -336,70 +449,75 @@ int InitMachine(void)
 /****************************************************************************/
 void FlushSound(void)
 {
-  int i;
-  static int soundstate = 0;
+  int i, x;
   static int smooth = 0;
 
-  if (soundmode && soundDetected) {
-    int8_t *playbuf = al_get_audio_stream_fragment(stream);
-    if (playbuf) {
-      for (i=0;i<buf_size;++i) {
-        if (soundbuf[i]) {
-          soundstate = soundbuf[i];
-          soundbuf[i] = 0;
-        }
-        smooth = (smooth << audiofilter) + soundstate - smooth; 
-        smooth >>= audiofilter;
-        playbuf[i] = smooth;
-      }
-      al_set_audio_stream_fragment(stream, playbuf);
-      soundstate >>= 1;
-    }
+  if (!soundbuf) return;
+  // always render, so the steps of a muted interrupt don't pile up
+  Beeper_Render(soundbuf, mastervolume*512);
+  if (!soundDetected && !wav) return;
+  for (i=0;i<buf_size;++i) {
+    smooth = (smooth << audiofilter) + soundbuf[i] - smooth; 
+    smooth >>= audiofilter;
+    // keep feeding silence when muted, so the ring stays at its fill level
+    x = soundmode ? smooth * 4 : 0;
+    soundbuf[i] = x < -32768 ? -32768 : x > 32767 ? 32767 : x;
   }
+  // neither blocks; the audio and writer threads pass the samples on.
+  // When not synced, the recording waits rather than lose samples
+  if (soundDetected) AudioRing_Write(&soundring, soundbuf, buf_size);
+  if (wav) WavWriter_Write(wav, soundbuf, buf_size, !Sync);
 }
 
 void SyncEmulation(void)
 {
+  ALLEGRO_TIMEOUT timeout;
+
+  if (!Sync || TapeStreaming) return;
+  if (audiosync && audioThread) {
+    // sync emulation to the sound card: sleep until the audio thread has
+    // taken enough samples for the next interrupt to fit under the target
+    // fill level, so emulation never runs further ahead than that. A
+    // starved ring doesn't play until it is filled, so don't wait then
+    al_init_timeout(&timeout, 2.0 / IFreq);
+    al_lock_mutex(audioMutex);
+    while (AudioRing_Fill(&soundring) + buf_size > soundring.Target && !soundring.Starved)
+      if (al_wait_cond_until(audioCond, audioMutex, &timeout)) {
+        if (Debug)
+          printf("Audio sync timed out...\n");
+        break;
+      }
+    al_unlock_mutex(audioMutex);
+    // keep the timer from piling up events while it isn't used
+    al_flush_event_queue(timerQueue);
+    return;
+  }
   // sync emulation by waiting for timer event (fired 50/60 times a second)
-  if (Sync) {
-    if (al_get_next_event(timerQueue, &event)) {
-      if (Debug)
-        printf("Sync lagged behind @ ts %f...\n", event.timer.timestamp);
-      al_flush_event_queue(timerQueue);
-    }
-    else
-      al_wait_for_event(timerQueue, &event);   
+  if (al_get_next_event(timerQueue, &event)) {
+    if (Debug)
+      printf("Sync lagged behind @ ts %f...\n", event.timer.timestamp);
+    al_flush_event_queue(timerQueue);
   }
+  else
+    al_wait_for_event(timerQueue, &event);   
 }
 
 /****************************************************************************/
-/*** This function is called when the sound register is written to        ***/
+/*** Upload a font atlas from memory to a bitmap with a single lock       ***/
 /****************************************************************************/
-void Sound(int toggle)
+int UploadFontBitmap(ALLEGRO_BITMAP *bitmap, const byte *atlas, uint32_t fg, uint32_t bg)
 {
-  static int last=-1;
-  int pos,val;
-
-  if (!soundmode || !soundDetected) 
-    return;
-
-  if (toggle!=last) {
-    last=toggle;
-    pos=(buf_size-1)-((buf_size-1)*Z80_ICount/Z80_IPeriod);
-    val=(toggle)? (-mastervolume*8):(mastervolume*8);
-    soundbuf[pos]=val;
+  int x, y;
+  uint32_t *row;
+  ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ARGB_8888, ALLEGRO_LOCK_WRITEONLY);
+  if (!region) return 0;
+  for (y = 0; y < CHAR_TILE_HEIGHT; ++y) {
+    row = (uint32_t *)((char *)region->data + y * region->pitch);
+    for (x = 0; x < FONT_BITMAP_WIDTH; ++x)
+      row[x] = atlas[y * FONT_BITMAP_WIDTH + x] ? fg : bg;
   }
-}
-
-void drawFontRegion(float x1, float y1, float x2, float y2)
-{
-  /* Draw the font on an internal bitmap */
-  al_set_target_bitmap(FontBuf);
-  al_draw_filled_rectangle(x1, y1, x2, y2, al_map_rgb(255, 255, 255));
-
-  /* Draw the inverted font on an internal bitmap */
-  al_set_target_bitmap(FontBuf_bk);
-  al_draw_filled_rectangle(x1, y1, x2, y2, al_map_rgb(0, 0, 0));
+  al_unlock_bitmap(bitmap);
+  return 1;
 }
 
 /****************************************************************************/
@@ -407,11 +525,9 @@ void drawFontRegion(float x1, float y1, float x2, float y2)
 /****************************************************************************/
 int LoadFont(const char *filename)
 {
-  int i, line, x, y, pixelPos;
-  int linePixels, linePixelsPrev, linePixelsNext;
-  int pixelN, pixelE, pixelS, pixelW;
-  int pixelSW, pixelSE, pixelNW, pixelNE;
-  char *TempBuf;
+  int i = 0, y;
+  byte *TempBuf = NULL, *Glyphs = NULL, *Atlas = NULL;
+  byte *glyph, *tile;
   FILE *F;
 
   if (Verbose) printf("Loading font %s...\n", filename);
@@ -428,16 +544,13 @@ int LoadFont(const char *filename)
     return 0;
   }
 
-  al_set_target_bitmap(FontBuf);
-  al_clear_to_color(al_map_rgb(0, 0, 0));
-  al_set_target_bitmap(FontBuf_bk);
-  al_clear_to_color(al_map_rgb(255, 255, 255));
-
-  if (Verbose) printf("  Allocating memory for temp buffer for font... ");
-  TempBuf = malloc(2240);
-  if (!TempBuf) {
-    ShowErrorMessage("Could not allocate temp buffer for font.");
-    return 0;
+  if (Verbose) printf("  Allocating memory for temp buffers for font... ");
+  TempBuf = malloc(SAA5050_FONT_SIZE);
+  Glyphs = malloc(SAA5050_CHARS * CHAR_TILE_WIDTH * CHAR_TILE_HEIGHT);
+  Atlas = calloc(FONT_BITMAP_WIDTH * CHAR_TILE_HEIGHT, 1);
+  if (!TempBuf || !Glyphs || !Atlas) {
+    ShowErrorMessage("Could not allocate temp buffers for font.");
+    goto freeBuffers;
   }
   if (Verbose) puts("OK");
 
@@ -446,74 +559,42 @@ int LoadFont(const char *filename)
   F = fopen(filename, "rb");
   if (F) {
     if (Verbose) printf("Reading... ");
-    if (fread(TempBuf, 2240, 1, F)) i = 1;
+    if (fread(TempBuf, SAA5050_FONT_SIZE, 1, F)) i = 1;
     fclose(F);
   }
   if (Verbose) puts(i ? "OK" : "FAILED");
   if (!i) {
     ShowErrorMessage("Could not read font file %s", filename);
-    return 0;
+    goto freeBuffers;
   }
 
   // Stretch 6x10 characters to 12x20, so we can do character rounding 
   // 96 alpha + 64 graphic (cont) + 64 graphic (sep)
-  for (i = 0; i < (96 + 64 + 64) * 10; i += 10) { 
-    linePixelsPrev = 0;
-    linePixels = 0;
-    linePixelsNext = TempBuf[i] << 6;
-    for (line = 0; line < 10; ++line) {
-      y = line * CHAR_PIXEL_HEIGHT;
-      linePixelsPrev = linePixels >> 6;
-      linePixels = linePixelsNext >> 6;
-      linePixelsNext = line < 9 ? TempBuf[i + line + 1] : 0;
-
-      for (pixelPos = 0; pixelPos < 6; ++pixelPos) {
-        x = (i * 6 / 10 + pixelPos) * CHAR_PIXEL_WIDTH + i / 10 * CHAR_TILE_SPACE;
-        if (linePixels & 0x20) // bit 6 set = pixel set
-          drawFontRegion(
-            x - (pixelPos ? 0 : 1), 
-            y - (line ? 0 : 1), 
-            x + CHAR_PIXEL_WIDTH + (pixelPos == 5 ? 1 : 0), 
-            y + CHAR_PIXEL_HEIGHT+ (line == 9 ? 1 : 0));
-        else {
-          /* character rounding */
-          if (i < 96 * 10) { // check if within alpanum character range
-            // for character rounding, look at 8 pixels around current pixel
-            pixelN = linePixelsPrev & 0x20;
-            pixelE = linePixels & 0x10;
-            pixelS = linePixelsNext & 0x20;
-            pixelW = linePixels & 0x40;
-            pixelNE = linePixelsPrev & 0x10;
-            pixelSE = linePixelsNext & 0x10;
-            pixelSW = linePixelsNext & 0x40;
-            pixelNW = linePixelsPrev & 0x40;
-            
-            // rounding in NW direction
-            if (pixelN && pixelW && !pixelNW) {
-              drawFontRegion(x,y,x+CHAR_PIXEL_WIDTH/2,y+CHAR_PIXEL_HEIGHT/2);
-            }
-            // rounding in NE direction
-            if (pixelN && pixelE && !pixelNE) {
-              drawFontRegion(x+CHAR_PIXEL_WIDTH/2,y,x+CHAR_PIXEL_WIDTH,y+CHAR_PIXEL_HEIGHT/2);
-            }
-            // rounding in SE direction
-            if (pixelS && pixelE && !pixelSE) {
-              drawFontRegion(x+CHAR_PIXEL_WIDTH/2, y+CHAR_PIXEL_HEIGHT/2, x+CHAR_PIXEL_WIDTH, y+CHAR_PIXEL_HEIGHT);
-            }
-            // rounding in SW direction
-            if (pixelS && pixelW && !pixelSW) {
-              drawFontRegion(x, y+CHAR_PIXEL_HEIGHT/2, x+CHAR_PIXEL_WIDTH/2, y+CHAR_PIXEL_HEIGHT);
-            }
-          }
-        }
-        //process next pixel to the right
-        linePixelsPrev<<=1;
-        linePixels<<=1;
-        linePixelsNext<<=1;
-      }
+  SAA5050_BuildFont(TempBuf, Glyphs, CHAR_PIXEL_WIDTH);
+
+  // Put the glyphs next to each other in the atlas, extending the outer
+  // pixels into the tile spacing so smoothing doesn't fade the edges
+  for (i = 0; i < SAA5050_CHARS; ++i) {
+    for (y = 0; y < CHAR_TILE_HEIGHT; ++y) {
+      glyph = Glyphs + (i * CHAR_TILE_HEIGHT + y) * CHAR_TILE_WIDTH;
+      tile = Atlas + y * FONT_BITMAP_WIDTH + i * (CHAR_TILE_WIDTH + CHAR_TILE_SPACE);
+      memcpy(tile, glyph, CHAR_TILE_WIDTH);
+      if (i) tile[-1] = glyph[0];
+      tile[CHAR_TILE_WIDTH] = glyph[CHAR_TILE_WIDTH - 1];
     }
   }
+
+  // Upload the font and the inverted font to the internal bitmaps
+  i = UploadFontBitmap(FontBuf, Atlas, 0xFFFFFFFF, 0xFF000000) &&
+      UploadFontBitmap(FontBuf_bk, Atlas, 0xFF000000, 0xFFFFFFFF);
+  if (!i) ShowErrorMessage("Could not lock font bitmaps.");
+
+freeBuffers:
+  // free() ignores the buffers that were not allocated
   free(TempBuf);
+  free(Glyphs);
+  free(Atlas);
+  if (!i) return 0;
 
   // copy the font bitmaps to smoothened bitmaps
   al_set_target_bitmap(smFontBuf);
@@ -582,10 +663,41 @@ void OpenCassetteDialog(bool boot)
     al_set_mouse_cursor(display, hiddenMouse);
 }
 
+void IndexCassettes()
+{
+  ALLEGRO_PATH *folder = al_clone_path(userCassettesPath);
+  TapeLib *L;
+  char message[1024];
+  int i, files = 0, duplicates = 0, failed = 0;
+
+  al_set_path_filename(folder, NULL);
+  al_set_system_mouse_cursor(display, ALLEGRO_SYSTEM_MOUSE_CURSOR_BUSY);
+  if ((L = TapeLib_Open(al_path_cstr(folder, PATH_SEPARATOR), NULL)) && TapeLib_Scan(L, TAPELIB_THREADS) >= 0) {
+    for (i = 0; i < L->Count; i++) {
+      files += L->Entries[i].FileCount;
+      duplicates += L->Entries[i].Duplicate >= 0;
+      failed += L->Entries[i].Status == TAPELIB_FAILED;
+    }
+    if (TapeLib_Save(L)) {
+      snprintf(message, sizeof(message), _(INDEX_CASSETTES_MSG), L->Count, files, duplicates, failed, L->Index);
+      al_show_native_message_box(display, Title, "", message, NULL, 0);
+    } else
+      ShowErrorMessage("Can't write %s.", L->Index);
+  } else
+    ShowErrorMessage("Can't read folder %s.", al_path_cstr(folder, PATH_SEPARATOR));
+  TapeLib_Close(L);
+  al_destroy_path(folder);
+  al_set_system_mouse_cursor(display, ALLEGRO_SYSTEM_MOUSE_CURSOR_DEFAULT);
+  if (al_get_display_flags(display) & ALLEGRO_FULLSCREEN_WINDOW)
+    al_set_mouse_cursor(display, hiddenMouse);
+}
+
 void IndicateActionDone() {
   //briefly flash white screen to indicate action was done
+  LockDisplay();
   al_clear_to_color(al_map_rgb(255, 255, 255));
   al_flip_display();
+  UnlockDisplay();
   Pause(20);
   ClearScreen();
 }
@@ -774,6 +886,9 @@ void Keyboard(void)
           RemoveCassette();
           UpdateWindowTitle();
           break;
+        case FILE_INDEX_CASSETTES_ID:
+          IndexCassettes();
+          break;
         case FILE_INSERT_CARTRIDGE_ID:
           cartridgeChooser = al_create_native_file_dialog(al_path_cstr(userCartridgesPath, PATH_SEPARATOR), _(DIALOG_LOAD_CARTRIDGE), "*.bin", ALLEGRO_FILECHOOSER_FILE_MUST_EXIST);
           if (al_show_native_file_dialog(display, cartridgeChooser) && al_get_native_file_dialog_count(cartridgeChooser) > 0) {
@@ -800,7 +915,9 @@ void Keyboard(void)
         case FILE_SAVE_SCREENSHOT_ID:
           screenshotChooser = al_create_native_file_dialog(al_path_cstr(userScreenshotsPath, PATH_SEPARATOR), _(DIALOG_SAVE_SCREENSHOT),  "*.png;*.bmp", ALLEGRO_FILECHOOSER_SAVE);
           if (al_show_native_file_dialog(display, screenshotChooser) && al_get_native_file_dialog_count(screenshotChooser) > 0) {
-            al_save_bitmap(AppendExtensionIfMissing(al_get_native_file_dialog_path(screenshotChooser, 0), ".png"), al_get_target_bitmap());
+            LockDisplay();
+            al_save_bitmap(AppendExtensionIfMissing(al_get_native_file_dialog_path(screenshotChooser, 0), ".png"), al_get_backbuffer(display));
+            UnlockDisplay();
             refreshPath(&userScreenshotsPath, al_get_native_file_dialog_path(screenshotChooser, 0));
           }
           al_destroy_native_file_dialog(screenshotChooser);
@@ -965,9 +1082,11 @@ void Keyboard(void)
         case DISPLAY_WINDOW_640x480: case DISPLAY_WINDOW_960x720: case DISPLAY_WINDOW_1280x960: 
         case DISPLAY_WINDOW_1600x1200: case DISPLAY_WINDOW_1920x1440:
           videomode = event.user.data1 - DISPLAY_WINDOW_MENU;
-          UpdateDisplaySettings();
           UpdateViewMenu();
+          LockDisplay();
+          UpdateDisplaySettings();
           al_resize_display(display, DisplayWidth + 2* DisplayHBorder, DisplayHeight + 2*DisplayVBorder);
+          UnlockDisplay();
           ClearScreen();
           break;
       }
@@ -1051,7 +1170,9 @@ void Keyboard(void)
     strftime(extension, 25, " %Y-%m-%d %H-%M-%S.png", localtime(&now));
     al_set_path_filename(userScreenshotsPath, currentTapePath ? al_get_path_filename(currentTapePath) : "Screenshot");
     al_set_path_extension(userScreenshotsPath, extension);
-    al_save_bitmap(al_path_cstr(userScreenshotsPath, PATH_SEPARATOR), al_get_target_bitmap());
+    LockDisplay();
+    al_save_bitmap(al_path_cstr(userScreenshotsPath, PATH_SEPARATOR), al_get_backbuffer(display));
+    UnlockDisplay();
     al_set_path_filename(userScreenshotsPath, NULL);
     IndicateActionDone();
   }
@@ -1127,15 +1248,85 @@ void PutImage (void)
   al_flip_display();
 }
 
+/****************************************************************************/
+/*** The render thread draws the latest video snapshot published by       ***/
+/*** PutScreen(), while the Z80 emulation carries on with the next frame  ***/
+/****************************************************************************/
+void *RenderThread(ALLEGRO_THREAD *thread, void *arg)
+{
+  int front;
+  for (;;) {
+    al_lock_mutex(renderMutex);
+    while (!renderReady && !al_get_thread_should_stop(thread))
+      al_wait_cond(renderCond, renderMutex);
+    if (!renderReady) { // asked to stop
+      al_unlock_mutex(renderMutex);
+      break;
+    }
+    // take the back snapshot; the Z80 thread continues with the other one
+    front = renderBack;
+    renderBack ^= 1;
+    renderReady = 0;
+    al_unlock_mutex(renderMutex);
+
+    LockDisplay();
+    DrawScreen(&renderStates[front]);
+    UnlockDisplay();
+  }
+  return NULL;
+}
+
+void StartRenderThread() 
+{
+  if (Verbose) printf("Starting render thread... ");
+  renderMutex = al_create_mutex();
+  renderCond = al_create_cond();
+  displayMutex = al_create_mutex();
+  if (renderMutex && renderCond && displayMutex)
+    renderThread = al_create_thread(RenderThread, NULL);
+  if (renderThread) {
+    al_set_target_bitmap(NULL); // the display is taken with LockDisplay() from now on
+    al_start_thread(renderThread);
+  } 
+  else
+    renderthread = 0; // draw on the emulation thread instead
+  if (Verbose) puts(renderThread ? "OK" : "FAILED");
+}
+
+/****************************************************************************/
+/*** This function is called on every screen refresh. It publishes the    ***/
+/*** video snapshot to the render thread, or draws it directly when the   ***/
+/*** render thread is disabled                                            ***/
+/****************************************************************************/
+void PutScreen(const VideoState *V)
+{
+  // the render thread is started on the first refresh, when the font
+  // bitmaps have been created on this thread. It may skip frames, so it
+  // is not used while the screen is captured
+  if (renderthread && !renderThread && !CaptureName)
+    StartRenderThread();
+  if (!renderThread) {
+    DrawScreen(V);
+    return;
+  }
+  // overwrite the back snapshot; if the render thread didn't pick up the
+  // previous one yet, that frame is simply skipped
+  al_lock_mutex(renderMutex);
+  renderStates[renderBack] = *V;
+  renderReady = 1;
+  al_signal_cond(renderCond);
+  al_unlock_mutex(renderMutex);
+}
+
 /****************************************************************************/
 /*** Put a character in the display buffer for P2000T emulation mode      ***/
 /****************************************************************************/
 void PutChar(int x, int y, int c, int fg, int bg, int si)
 {
   int K = c + (fg << 8) + (bg << 16) + (si << 24);
-  if (K == OldCharacter[y * 40 + x])
+  if (K == OldCharacter[y * 80 + x])
     return;
-  OldCharacter[y * 40 + x] = K;
+  OldCharacter[y * 80 + x] = K;
 
   if (c > 0 && Debug) {
     printf("PutChar (%i,%i,%i,%i,%i,%i);\n", x, y, c, fg, bg, si);
@@ -45,7 +45,14 @@ ALLEGRO_PATH *currentTapePath = NULL;
 
 int buf_size;
 int sample_rate;
-signed char *soundbuf = NULL;      /* Pointer to sound buffer               */
+short *soundbuf = NULL;            /* Beeper samples of one interrupt       */
+AudioRing soundring;               /* Samples on their way to the stream    */
+ALLEGRO_THREAD *audioThread = NULL;/* Feeds the stream from the ring        */
+ALLEGRO_EVENT_QUEUE *audioQueue = NULL; /* Fragment events of the stream    */
+ALLEGRO_MUTEX *audioMutex = NULL;  /* Guards waiting on audioCond           */
+ALLEGRO_COND *audioCond = NULL;    /* Signalled when samples were taken     */
+int audiosync;                     /* 1 if the sound card paces emulation   */
+WavWriter *wav = NULL;             /* Sound capture, see WavName            */
 int mastervolume;                  /* Master volume setting                 */
 
 ALLEGRO_EVENT event;
@@ -80,6 +87,15 @@ bool lastJoyState[5];
 ALLEGRO_EVENT_QUEUE *timerQueue = NULL;
 ALLEGRO_TIMER *timer;
 
+int renderthread;                  /* 1 if the screen is drawn by a thread  */
+ALLEGRO_THREAD *renderThread = NULL;
+ALLEGRO_MUTEX *renderMutex = NULL; /* Guards the video snapshots            */
+ALLEGRO_COND *renderCond = NULL;   /* Signalled when a snapshot is ready    */
+ALLEGRO_MUTEX *displayMutex = NULL;/* Held while drawing to the display     */
+static VideoState renderStates[2]; /* Double buffered video snapshots       */
+static int renderBack = 0;         /* Snapshot written by the Z80 thread    */
+static int renderReady = 0;        /* 1 if the back snapshot is new         */
+
 int soundmode;                     /* Sound mode, 1=on                      */
 int soundDetected;
 static int *OldCharacter;          /* Holds characters on the screen        */
@@ -143,9 +159,9 @@ void UpdateDisplaySettings()
 {
   DisplayWidth = Displays[videomode][0];
   DisplayHeight = Displays[videomode][1];
-  DisplayTileWidth = DisplayWidth / 40;
+  DisplayTileWidth = DisplayWidth / P2000_COLUMNS;
   DisplayTileHeight = DisplayHeight / 24;
-  DisplayHBorder = DisplayTileWidth;
+  DisplayHBorder = DisplayWidth / 40;
   DisplayVBorder = DisplayTileHeight / 2;
   if (Verbose) printf("DisplayTileWidth: %i, DisplayTileHeight: %i\n", DisplayTileWidth, DisplayTileHeight);
 }
@@ -67,6 +67,7 @@ void CreateEmulatorMenu()
       { _(FILE_INSERT_CASSETTE_ID), FILE_INSERT_CASSETTE_ID, 0, NULL },
       { _(FILE_BOOT_CASSETTE_ID), FILE_BOOT_CASSETTE_ID, 0, NULL },
       { _(FILE_REMOVE_CASSETTE_ID), FILE_REMOVE_CASSETTE_ID, 0, NULL },
+      { _(FILE_INDEX_CASSETTES_ID), FILE_INDEX_CASSETTES_ID, 0, NULL },
       ALLEGRO_MENU_SEPARATOR,
       { _(FILE_INSERT_CARTRIDGE_ID), FILE_INSERT_CARTRIDGE_ID, 0, NULL },
       { _(FILE_REMOVE_CARTRIDGE_ID), FILE_REMOVE_CARTRIDGE_ID, 0, NULL },
@@ -38,6 +38,7 @@ typedef struct {
 #define FILE_SAVE_VIDEORAM_ID             10
 #define FILE_SAVE_STATE_ID                11
 #define FILE_LOAD_STATE_ID                12
+#define FILE_INDEX_CASSETTES_ID           14
 #define DISPLAY_WINDOW_MENU               20
 #define DISPLAY_WINDOW_640x480            21
 #define DISPLAY_WINDOW_960x720            22
@@ -105,12 +106,14 @@ typedef struct {
 #define OPTIONS_AUDIOFILTER_0_ID          117
 #define OPTIONS_AUDIOFILTER_1_ID          118
 #define OPTIONS_AUDIOFILTER_2_ID          119
+#define INDEX_CASSETTES_MSG               120
 
 static LanguageEntry ENstrings[] = {
   { FILE_MENU_ID, "File->" },
   { FILE_INSERT_CASSETTE_ID, "Insert Cassette... (Ctrl-I)" },
   { FILE_BOOT_CASSETTE_ID, "Open/Boot Cassette... (Ctrl-O)" },
   { FILE_REMOVE_CASSETTE_ID, "Eject Cassette (Ctrl-E)" },
+  { FILE_INDEX_CASSETTES_ID, "Index Cassette Folder" },
   { FILE_INSERT_CARTRIDGE_ID, "Insert Cartridge..." },
   { FILE_REMOVE_CARTRIDGE_ID, "Remove Cartridge" },
   { FILE_RESET_ID, "Restart (Ctrl-R)" },
@@ -166,6 +169,7 @@ static LanguageEntry ENstrings[] = {
   { DIALOG_LOAD_STATE, "Select a .sav file" },
   { DIALOG_SAVE_STATE, "Save as .sav file" },
   { NO_CASSETTE, "no cassette" },
+  { INDEX_CASSETTES_MSG, "%d cassettes with %d files, of which %d hold the same tape as another one and %d could not be read.\n\nThe index is saved in %s" },
   { 0, NULL },
 };
 
@@ -174,6 +178,7 @@ static LanguageEntry NLstrings[] = {
   { FILE_INSERT_CASSETTE_ID, "Invoeren cassette... (Ctrl-I)"},
   { FILE_BOOT_CASSETTE_ID, "Opstarten cassette... (Ctrl-O)" },
   { FILE_REMOVE_CASSETTE_ID, "Verwijder cassette (Ctrl-E)" },
+  { FILE_INDEX_CASSETTES_ID, "Indexeer cassettemap" },
   { FILE_INSERT_CARTRIDGE_ID, "Invoeren cartridge..." },
   { FILE_REMOVE_CARTRIDGE_ID, "Verwijder cartridge" },
   { FILE_RESET_ID, "Herstart (Ctrl-R)" },
@@ -229,6 +234,7 @@ static LanguageEntry NLstrings[] = {
   { DIALOG_LOAD_STATE, "Selecteer een .sav bestand" },
   { DIALOG_SAVE_STATE, "Bewaar als .sav bestand" },
   { NO_CASSETTE, "geen cassette" },
+  { INDEX_CASSETTES_MSG, "%d cassettes met %d bestanden, waarvan %d dezelfde tape bevatten als een andere en %d niet gelezen konden worden.\n\nDe index is bewaard in %s" },
   { 0, NULL },
 };
 
@@ -0,0 +1,237 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the capture converter. It turns a cell stream recorded
+// with the capture=<filename> option into a sequence of PNG pictures, or
+// into a stream of PPM pictures that can be piped into a video encoder:
+//   capconv capture.cs - | ffmpeg -f image2pipe -framerate 50 -c:v ppm -i -
+//                                 -c:v ffv1 capture.mkv
+// Build with: gcc -O2 -o capconv capconv.c ../CellStream.c ../SAA5050.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../CellStream.h"
+#include "../SAA5050.h"
+
+static CellStreamInfo Info;
+static byte Glyphs[SAA5050_CHARS*SAA5050_CHAR_WIDTH*SAA5050_CHAR_HEIGHT*4*4];
+static int Scale = 2;
+static int Width, Height;
+static dword *Frame;            /* Picture, one palette index per pixel    */
+static byte *Line;              /* Output buffer for one row of pixels     */
+static dword CRCTable[256];
+
+/****************************************************************************/
+/*** Draw all cells on the picture                                        ***/
+/****************************************************************************/
+static void DrawFrame(const int *Cells)
+{
+  int x, y, k;
+  for (y = 0; y < Info.Rows; ++y)
+    for (x = 0; x < Info.Columns; ++x)
+    {
+      k = Cells[y * Info.Columns + x];
+      SAA5050_PutChar(Frame, Width, 32, Glyphs, Scale, x, y, CELL_CHAR(k),
+                      CELL_FG(k), CELL_BG(k), CELL_SI(k));
+    }
+}
+
+/****************************************************************************/
+/*** Write the picture as a binary PPM                                    ***/
+/****************************************************************************/
+static int WritePPM(FILE *F)
+{
+  int x, y;
+  const byte *P;
+  fprintf(F, "P6\n%d %d\n255\n", Width, Height);
+  for (y = 0; y < Height; ++y)
+  {
+    for (x = 0; x < Width; ++x)
+    {
+      P = Info.Palette + 3 * Frame[y * Width + x];
+      memcpy(Line + 3 * x, P, 3);
+    }
+    if (fwrite(Line, 3 * Width, 1, F) != 1)
+      return 0;
+  }
+  return 1;
+}
+
+/****************************************************************************/
+/*** PNG helpers: CRC-32 of the chunks and chunk output                   ***/
+/****************************************************************************/
+static void InitCRC(void)
+{
+  dword c;
+  int n, k;
+  for (n = 0; n < 256; ++n)
+  {
+    for (c = n, k = 0; k < 8; ++k)
+      c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    CRCTable[n] = c;
+  }
+}
+
+static dword CRC(dword crc, const byte *buf, int len)
+{
+  while (len--)
+    crc = CRCTable[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+static void PutLong(byte *P, dword v)
+{
+  P[0] = v >> 24; P[1] = v >> 16; P[2] = v >> 8; P[3] = v;
+}
+
+static int WriteChunk(FILE *F, const char *type, const byte *data, int len)
+{
+  byte B[8];
+  dword crc;
+  PutLong(B, len);
+  memcpy(B + 4, type, 4);
+  crc = CRC(0xFFFFFFFF, B + 4, 4);
+  crc = CRC(crc, data, len) ^ 0xFFFFFFFF;
+  if (fwrite(B, 8, 1, F) != 1 || (len && fwrite(data, len, 1, F) != 1))
+    return 0;
+  PutLong(B, crc);
+  return fwrite(B, 4, 1, F) == 1;
+}
+
+/****************************************************************************/
+/*** Write the picture as an 8-bit paletted PNG. The image data is stored ***/
+/*** in uncompressed deflate blocks, so no compression library is needed, ***/
+/*** which makes the files large but quick to write                        ***/
+/****************************************************************************/
+static int WritePNG(FILE *F)
+{
+  static const byte Signature[8] = { 0x89,'P','N','G','\r','\n',0x1A,'\n' };
+  byte IHDR[13] = { 0 };
+  byte *Data, *P;
+  int stride = Width + 1;       /* filter byte + one index per pixel */
+  int raw = stride * Height;
+  int blocks = (raw + 0xFFFE) / 0xFFFF;
+  int x, y, i, j, n, ok;
+  dword a = 1, b = 0;           /* Adler-32 of the image data */
+
+  if (!(Data = malloc(2 + raw + 5 * blocks + 4)))
+    return 0;
+  PutLong(IHDR, Width);
+  PutLong(IHDR + 4, Height);
+  IHDR[8] = 8;                  /* bit depth */
+  IHDR[9] = 3;                  /* paletted */
+  P = Data;
+  *P++ = 0x78; *P++ = 0x01;     /* zlib header */
+  for (i = 0, y = 0, x = -1; i < raw; i += n)
+  {
+    n = raw - i > 0xFFFF ? 0xFFFF : raw - i;
+    *P++ = i + n == raw;        /* stored block, final flag */
+    *P++ = n; *P++ = n >> 8;
+    *P++ = ~n; *P++ = ~n >> 8;
+    for (j = 0; j < n; ++j, ++P)
+    {
+      *P = x < 0 ? 0 : Frame[y * Width + x];
+      a = (a + *P) % 65521;
+      b = (b + a) % 65521;
+      if (++x == Width) { x = -1; ++y; }
+    }
+  }
+  PutLong(P, (b << 16) | a);
+  P += 4;
+  ok = fwrite(Signature, 8, 1, F) == 1 &&
+       WriteChunk(F, "IHDR", IHDR, sizeof(IHDR)) &&
+       WriteChunk(F, "PLTE", Info.Palette, sizeof(Info.Palette)) &&
+       WriteChunk(F, "IDAT", Data, P - Data) &&
+       WriteChunk(F, "IEND", NULL, 0);
+  free(Data);
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *FontName = "Default.fnt";
+  const char *Output;
+  byte Font[SAA5050_FONT_SIZE];
+  int Cells[CELLSTREAM_MAX_CELLS];
+  char Name[FILENAME_MAX];
+  FILE *In, *F;
+  int i, frames, ok;
+
+  for (i = 1; i < argc - 2; ++i)
+  {
+    if (!strcmp(argv[i], "-scale") && i < argc - 3)
+      Scale = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-font") && i < argc - 3)
+      FontName = argv[++i];
+    else
+      break;
+  }
+  if (argc - i != 2 || (Scale != 1 && Scale != 2 && Scale != 4))
+  {
+    fprintf(stderr, "capconv: M2000 capture converter\n"
+            "Usage: capconv [-scale 1|2|4] [-font <file>] <stream> <output>\n"
+            "  <output> is the prefix of the PNG files (<output>00000.png,\n"
+            "  <output>00001.png, ...) or - to write PPM pictures to stdout\n");
+    return 1;
+  }
+  Output = argv[i + 1];
+
+  if (!(F = fopen(FontName, "rb")) || fread(Font, sizeof(Font), 1, F) != 1)
+  {
+    fprintf(stderr, "Cannot read font %s\n", FontName);
+    return 2;
+  }
+  fclose(F);
+  if (!(In = fopen(argv[i], "rb")) || !CellStream_ReadHeader(In, &Info))
+  {
+    fprintf(stderr, "%s is not a cell stream\n", argv[i]);
+    return 3;
+  }
+  SAA5050_BuildFont(Font, Glyphs, Scale);
+  Width = Info.Columns * SAA5050_CHAR_WIDTH * Scale;
+  Height = Info.Rows * SAA5050_CHAR_HEIGHT * Scale;
+  Frame = malloc(Width * Height * sizeof(dword));
+  Line = malloc(3 * Width);
+  if (!Frame || !Line)
+  {
+    fprintf(stderr, "Out of memory\n");
+    return 4;
+  }
+  for (i = 0; i < CELLSTREAM_MAX_CELLS; ++i)
+    Cells[i] = CELL(0, 7, 0, 0); // blank until the first frame is drawn
+  InitCRC();
+
+  for (frames = 0, ok = 1; ok && CellStream_ReadFrame(In, &Info, Cells) >= 0; ++frames)
+  {
+    DrawFrame(Cells);
+    if (!strcmp(Output, "-"))
+      ok = WritePPM(stdout);
+    else
+    {
+      sprintf(Name, "%.*s%05d.png", FILENAME_MAX - 16, Output, frames);
+      ok = (F = fopen(Name, "wb")) && WritePNG(F);
+      if (F) ok = !fclose(F) && ok;
+    }
+  }
+  fclose(In);
+  fprintf(stderr, "%d frames of %dx%d pixels at %g fps%s\n", frames, Width,
+          Height, (double)Info.RateNum / Info.RateDen, ok ? "" : ", write error");
+  return ok ? 0 : 5;
+}
@@ -0,0 +1,96 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the cassette to WAV converter. It renders the blocks
+// of a .cas image as the signal the P2000 writes to tape, to record them
+// back onto a real cassette. The blocks are rendered one at a time and
+// the WAV file is written behind, so memory use doesn't grow with the
+// length of the tape:
+//   cas2wav [-r rate] <cassette.cas> <recording.wav>
+// Build with: gcc -O2 -o cas2wav cas2wav.c ../Mdcr.c ../Tape.c ../Gzip.c
+//             ../WavWriter.c ../AudioRing.c -lpthread
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../Tape.h"
+#include "../WavWriter.h"
+#include "../Mdcr.h"
+
+/****************************************************************************/
+/*** Queue samples for the WAV writer, waiting for room                   ***/
+/****************************************************************************/
+static int PutSamples(void *arg, const short *samples, int n)
+{
+  return WavWriter_Write(arg, samples, n, 1) == n;
+}
+
+int main(int argc, char *argv[])
+{
+  MdcrEncoder *E;
+  WavWriter *W;
+  const byte *block;
+  Tape *T;
+  long b, blocks;
+  int i, rate = 44100, ok;
+
+  for (i = 1; i + 1 < argc && !strcmp(argv[i], "-r"); i += 2)
+    rate = atoi(argv[i + 1]);
+  if (argc - i != 2)
+  {
+    fprintf(stderr,
+            "Usage: cas2wav [-r rate] <cassette.cas> <recording.wav>\n"
+            "  -r  sample rate of the recording, at least %d [44100]\n", MDCR_RATE);
+    return 1;
+  }
+  if (rate < MDCR_RATE)
+  {
+    fprintf(stderr, "A sample rate of %d Hz is too low to hold the signal, "
+                    "use at least %d Hz\n", rate, MDCR_RATE);
+    return 1;
+  }
+  if (!(T = Tape_OpenFile(fopen(argv[i], "rb"), 1)))
+  {
+    fprintf(stderr, "Cannot read %s\n", argv[i]);
+    return 2;
+  }
+  if (!(W = WavWriter_Open(argv[i + 1], rate)))
+  {
+    fprintf(stderr, "Cannot create %s\n", argv[i + 1]);
+    return 2;
+  }
+  if (!(E = Mdcr_NewEncoder(rate, PutSamples, W)))
+  {
+    fprintf(stderr, "Cannot encode at %d Hz\n", rate);
+    return 2;
+  }
+  blocks = Tape_Blocks(T);
+  for (b = 0, ok = 1; ok && b < blocks && (block = Tape_Read(T, TAPE_BLOCK_SIZE)); ++b)
+    ok = Mdcr_Encode(E, block + TAPE_HEADER_OFFSET, block + TAPE_HEADER_SIZE);
+  ok = Mdcr_CloseEncoder(E) && ok;
+  ok = WavWriter_Close(W) && ok;
+  Tape_Close(T);
+  if (!ok || b < blocks)
+  {
+    fprintf(stderr, "Cannot write %s\n", argv[i + 1]);
+    return 2;
+  }
+  printf("%s: %ld block%s\n", argv[i + 1], blocks, blocks == 1 ? "" : "s");
+  return 0;
+}
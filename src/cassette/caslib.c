@@ -0,0 +1,149 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the cassette library tool. It indexes the .cas tape
+// images in a folder and its subfolders, gzip compressed or not, and lists
+// them with the files on each, or only the images that hold the same tape.
+// The index is kept in the folder, so a second run only reads the images
+// that were added or changed:
+//   caslib [-j threads] [-i index] [-d] [-q] <folder>
+// Build with: gcc -O2 -o caslib caslib.c ../TapeLib.c ../Tape.c ../Gzip.c -lpthread
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../TapeLib.h"
+
+static const char *Status[] = { "", "added", "changed", "failed" };
+
+/****************************************************************************/
+/*** Print an entry and the files on it                                   ***/
+/****************************************************************************/
+static void List(const TapeLib *L, const TapeLibEntry *E)
+{
+  int i;
+
+  printf("%s  %016llx  %s", E->Path, E->Hash, Status[E->Status]);
+  if (E->Status == TAPELIB_FAILED)
+  {
+    putchar('\n');
+    return;
+  }
+  printf("%s%ld block%s, %d file%s", *Status[E->Status] ? ", " : "", E->Blocks,
+         E->Blocks == 1 ? "" : "s", E->FileCount, E->FileCount == 1 ? "" : "s");
+  if (E->Duplicate >= 0)
+    printf(", same as %s", L->Entries[E->Duplicate].Path);
+  putchar('\n');
+  for (i = 0; i < E->FileCount; ++i)
+    printf("  %3ld %-16s %-3s %5u bytes at %04X\n", E->Files[i].Block,
+           E->Files[i].Name, E->Files[i].Ext, E->Files[i].Length, E->Files[i].Addr);
+}
+
+/****************************************************************************/
+/*** Return 1 if an image before entry j is a duplicate of entry first    ***/
+/****************************************************************************/
+static int Listed(const TapeLib *L, int first, int j)
+{
+  while (--j > first)
+    if (L->Entries[j].Duplicate == first)
+      return 1;
+  return 0;
+}
+
+/****************************************************************************/
+/*** Return the wall clock time in seconds                                ***/
+/****************************************************************************/
+static double Now(void)
+{
+  struct timespec ts;
+
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *index = NULL;
+  TapeLib *L;
+  double start;
+  int i, j, read, threads = TAPELIB_THREADS, dups = 0, quiet = 0;
+  int count[4] = { 0 };
+
+  for (i = 1; i < argc && argv[i][0] == '-'; ++i)
+  {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+      index = argv[++i];
+    else if (!strcmp(argv[i], "-d"))
+      dups = 1;
+    else if (!strcmp(argv[i], "-q"))
+      quiet = 1;
+    else
+      break;
+  }
+  if (i + 1 != argc)
+  {
+    fprintf(stderr,
+            "Usage: caslib [-j threads] [-i index] [-d] [-q] <folder>\n"
+            "  -j  read new and changed images on this many threads (%d)\n"
+            "  -i  index file, by default %s in the folder\n"
+            "  -d  only list the images that hold the same tape\n"
+            "  -q  only print the summary\n",
+            TAPELIB_THREADS, TAPELIB_INDEX);
+    return 1;
+  }
+  if (!(L = TapeLib_Open(argv[i], index)))
+  {
+    fprintf(stderr, "Out of memory\n");
+    return 2;
+  }
+  start = Now();
+  if ((read = TapeLib_Scan(L, threads)) < 0)
+  {
+    fprintf(stderr, "Cannot read %s\n", argv[i]);
+    TapeLib_Close(L);
+    return 2;
+  }
+  for (j = 0; j < L->Count; ++j)
+  {
+    ++count[L->Entries[j].Status];
+    if (!quiet && !dups)
+      List(L, L->Entries + j);
+    else if (!quiet && L->Entries[j].Duplicate >= 0)
+    {
+      // a group starts with the first image of the tape
+      if (!Listed(L, L->Entries[j].Duplicate, j))
+        List(L, L->Entries + L->Entries[j].Duplicate);
+      List(L, L->Entries + j);
+    }
+  }
+  printf("%d cassette%s: %d added, %d changed, %d removed, %d failed, %d read in %.2fs\n",
+         L->Count, L->Count == 1 ? "" : "s", count[TAPELIB_ADDED], count[TAPELIB_CHANGED],
+         L->Removed, count[TAPELIB_FAILED], read, Now() - start);
+  if (!TapeLib_Save(L))
+  {
+    fprintf(stderr, "Cannot write %s\n", L->Index);
+    TapeLib_Close(L);
+    return 2;
+  }
+  TapeLib_Close(L);
+  return count[TAPELIB_FAILED] ? 3 : 0;
+}
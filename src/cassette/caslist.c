@@ -0,0 +1,91 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the cassette lister. It prints the files on .cas tape
+// images, gzip compressed or not, the way the ZOEK key shows them, from the
+// index that the emulator builds when a cassette is inserted:
+//   caslist [-b] <cassette> ...
+// Build with: gcc -O2 -o caslist caslist.c ../Tape.c ../Gzip.c -lpthread
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "../Tape.h"
+
+/****************************************************************************/
+/*** Print the files on a tape and, with blocks, the header of each block ***/
+/****************************************************************************/
+static void List(Tape *T, int blocks)
+{
+  const TapeFile *F;
+  const byte *h;
+  long b;
+  int i, j, n;
+
+  F = Tape_Files(T, &n);
+  printf("%ld block%s, %d file%s\n", Tape_Blocks(T),
+         Tape_Blocks(T) == 1 ? "" : "s", n, n == 1 ? "" : "s");
+  for (i = 0; i < n; ++i)
+  {
+    printf("  %3ld %-16s %-3s %c %5u bytes at %04X, %ld block%s\n",
+           F[i].Block, F[i].Name, F[i].Ext, isprint(F[i].Type) ? F[i].Type : '?',
+           F[i].Length, F[i].Addr, F[i].Blocks, F[i].Blocks == 1 ? "" : "s");
+    for (b = F[i].Block; blocks && b < F[i].Block + F[i].Blocks; ++b)
+    {
+      h = Tape_Header(T, b);
+      printf("       %3ld:", b);
+      for (j = 0; j < 32; ++j)
+        printf(" %02X", h[j]);
+      putchar('\n');
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  Tape *T;
+  int i, blocks = 0, result = 0;
+
+  i = 1;
+  if (i < argc && !strcmp(argv[i], "-b"))
+  {
+    blocks = 1;
+    ++i;
+  }
+  if (i >= argc)
+  {
+    fprintf(stderr,
+            "Usage: caslist [-b] <cassette> ...\n"
+            "  -b  also print the P2000 header of every block\n");
+    return 1;
+  }
+  for (; i < argc; ++i)
+  {
+    if (!(T = Tape_OpenFile(fopen(argv[i], "rb"), 1)))
+    {
+      fprintf(stderr, "Cannot read %s\n", argv[i]);
+      result = 2;
+      continue;
+    }
+    printf("%s: ", argv[i]);
+    List(T, blocks);
+    Tape_Close(T);
+  }
+  return result;
+}
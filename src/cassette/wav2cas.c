@@ -0,0 +1,235 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the WAV to cassette converter. It decodes recordings
+// of P2000 cassettes into .cas images, reporting every block it finds and
+// whether its CRC is right. The recording is read a chunk at a time, so
+// hours of audio take little memory:
+//   wav2cas [-s] [-q] <recording.wav> <cassette.cas>
+// Build with: gcc -O2 -o wav2cas wav2cas.c ../Mdcr.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../Tape.h"
+#include "../Mdcr.h"
+
+#define CHUNK 4096              /* Sample frames read at a time             */
+
+static const char *Status[] = { "OK", "CRC error", "short", "no sync" };
+
+/** Wav ******************************************************************/
+/** The format of a WAV file and the sample data left to read          **/
+/*************************************************************************/
+typedef struct
+{
+  FILE *F;
+  int Rate, Channels, Bits, Float;
+  long Left;                    /* Bytes of sample data left                */
+} Wav;
+
+/** Output ***************************************************************/
+/** Where the blocks go, and how they went                              **/
+/*************************************************************************/
+typedef struct
+{
+  FILE *F;
+  int Strict, Quiet;            /* Options                                  */
+  int Blocks, Bad, Failed;      /* Blocks found, bad ones, write failure    */
+} Output;
+
+static dword GetDword(const byte *p) { return p[0] | p[1] << 8 | p[2] << 16 | (dword)p[3] << 24; }
+static word GetWord(const byte *p) { return p[0] | p[1] << 8; }
+
+/****************************************************************************/
+/*** Read the header of a WAV file up to its sample data. Returns 0 if    ***/
+/*** it isn't a WAV file with samples this program can read               ***/
+/****************************************************************************/
+static int OpenWav(Wav *W, FILE *F)
+{
+  byte b[40];
+  dword len;
+  int format = 0;
+
+  memset(W, 0, sizeof(*W));
+  W->F = F;
+  if (fread(b, 1, 12, F) != 12 || memcmp(b, "RIFF", 4) || memcmp(b + 8, "WAVE", 4))
+    return 0;
+  while (fread(b, 1, 8, F) == 8)
+  {
+    len = GetDword(b + 4);
+    if (!memcmp(b, "fmt ", 4) && len >= 16 && len <= sizeof(b))
+    {
+      if (fread(b, 1, len, F) != len)
+        return 0;
+      format = GetWord(b);
+      W->Channels = GetWord(b + 2);
+      W->Rate = GetDword(b + 4);
+      W->Bits = GetWord(b + 14);
+      // WAVE_FORMAT_EXTENSIBLE has the format in its sub-format
+      if (format == 0xFFFE && len >= 26)
+        format = GetWord(b + 24);
+      W->Float = format == 3;
+      if (len & 1)
+        fgetc(F);
+    }
+    else if (!memcmp(b, "data", 4))
+    {
+      W->Left = len;
+      return (format == 1 && (W->Bits == 8 || W->Bits == 16 || W->Bits == 24)) ||
+             (format == 3 && W->Bits == 32) ? W->Channels > 0 && W->Rate > 0 : 0;
+    }
+    else if (fseek(F, len + (len & 1), SEEK_CUR))
+      return 0;
+  }
+  return 0;
+}
+
+/****************************************************************************/
+/*** Read up to n sample frames, mixed down to mono. Returns the number   ***/
+/*** of frames read                                                       ***/
+/****************************************************************************/
+static int ReadWav(Wav *W, short *out, int n)
+{
+  static byte buf[CHUNK * 8 * 4];
+  int size, i, j, v;
+  const byte *p;
+  float f;
+  long m;
+
+  size = W->Bits / 8 * W->Channels;
+  if (n > (int)sizeof(buf) / size)
+    n = sizeof(buf) / size;
+  if (n > W->Left / size)
+    n = W->Left / size;
+  n = fread(buf, size, n, W->F);
+  W->Left -= (long)n * size;
+  for (i = 0, p = buf; i < n; ++i)
+  {
+    for (j = 0, m = 0; j < W->Channels; ++j, p += W->Bits / 8)
+    {
+      if (W->Float)
+      {
+        memcpy(&f, p, 4);
+        v = f < -1 ? -32768 : f > 1 ? 32767 : (int)(f * 32767);
+      }
+      else if (W->Bits == 8)
+        v = (p[0] - 128) << 8;
+      else
+        v = (short)GetWord(p + W->Bits / 8 - 2);
+      m += v;
+    }
+    out[i] = m / W->Channels;
+  }
+  return n;
+}
+
+/****************************************************************************/
+/*** Write a block to the cassette and report it                          ***/
+/****************************************************************************/
+static void PutBlock(void *arg, const MdcrBlock *B)
+{
+  Output *O = arg;
+  byte block[TAPE_BLOCK_SIZE];
+  char name[9];
+  int i, keep;
+
+  ++O->Blocks;
+  O->Bad += B->Status != MDCR_OK;
+  // a block that is complete but damaged is kept, unless strict
+  keep = B->Status == MDCR_OK || (B->Status == MDCR_BAD_CRC && !O->Strict);
+  if (!O->Quiet)
+  {
+    for (i = 0; i < 8; ++i)
+      name[i] = B->Header[6 + i] >= 32 && B->Header[6 + i] < 127 ? B->Header[6 + i] : '.';
+    name[8] = '\0';
+    printf("%9.2fs  %-8s  %s", B->Time, name, Status[B->Status]);
+    if (B->Status == MDCR_SHORT)
+      printf(", %d of %d bytes", B->Bytes, MDCR_RECORD);
+    puts(keep ? "" : ", dropped");
+  }
+  if (!keep)
+    return;
+  memset(block, 0, sizeof(block));
+  memcpy(block + TAPE_HEADER_OFFSET, B->Header, MDCR_HEADER);
+  memcpy(block + TAPE_HEADER_SIZE, B->Data, MDCR_DATA);
+  if (fwrite(block, 1, sizeof(block), O->F) != sizeof(block))
+    O->Failed = 1;
+}
+
+int main(int argc, char *argv[])
+{
+  static short samples[CHUNK];
+  MdcrDecoder *D;
+  Output O;
+  Wav W;
+  FILE *F;
+  clock_t start;
+  double seconds;
+  int i, n;
+
+  memset(&O, 0, sizeof(O));
+  for (i = 1; i < argc && argv[i][0] == '-'; ++i)
+    if (!strcmp(argv[i], "-s"))
+      O.Strict = 1;
+    else if (!strcmp(argv[i], "-q"))
+      O.Quiet = 1;
+    else
+      break;
+  if (argc - i != 2)
+  {
+    fprintf(stderr,
+            "Usage: wav2cas [-s] [-q] <recording.wav> <cassette.cas>\n"
+            "  -s  strict, drop blocks with a CRC error too\n"
+            "  -q  quiet, only print the summary\n");
+    return 1;
+  }
+  if (!(F = fopen(argv[i], "rb")) || !OpenWav(&W, F))
+  {
+    fprintf(stderr, "Cannot read %s as a WAV file\n", argv[i]);
+    return 2;
+  }
+  if (!(O.F = fopen(argv[i + 1], "wb")))
+  {
+    fprintf(stderr, "Cannot create %s\n", argv[i + 1]);
+    return 2;
+  }
+  if (!(D = Mdcr_NewDecoder(W.Rate, PutBlock, &O)))
+  {
+    fprintf(stderr, "Cannot decode %d Hz audio\n", W.Rate);
+    return 2;
+  }
+  if (W.Rate < MDCR_RATE)
+    fprintf(stderr, "Warning: %d Hz is too low for a reliable decoding\n", W.Rate);
+  start = clock();
+  for (seconds = 0; (n = ReadWav(&W, samples, CHUNK)) > 0; seconds += (double)n / W.Rate)
+    Mdcr_Decode(D, samples, n);
+  Mdcr_CloseDecoder(D);
+  fclose(F);
+  if (fclose(O.F) || O.Failed)
+  {
+    fprintf(stderr, "Cannot write %s\n", argv[i + 1]);
+    return 2;
+  }
+  printf("%s: %d block%s, %d bad, %.0fs of audio in %.2fs\n", argv[i + 1],
+         O.Blocks, O.Blocks == 1 ? "" : "s", O.Bad, seconds,
+         (double)(clock() - start) / CLOCKS_PER_SEC);
+  return O.Bad ? 3 : 0;
+}
@@ -30,40 +30,64 @@
 #include "m2000_saa5050.h"
 #include "../Z80.h"
 #include "../P2000.h"
+#include "../SAA5050.h"
+#include "../Beeper.h"
+#include "../WavWriter.h"
 
-#define VIDEO_BUFFER_WIDTH 480
+#define VIDEO_BUFFER_WIDTH 960 /* 80 columns on the P2000M */
 #define VIDEO_BUFFER_HEIGHT 480
-#define SAMPLE_RATE 30000
+#define SAMPLE_RATE 30000 /* default audio sample rate */
 #define P2000T_VRAM_SIZE 0x1000
-#define NUMBER_OF_CHARS (96 + 64 + 64)
+#define NUMBER_OF_CHARS SAA5050_CHARS
 #define CHAR_WIDTH 12
 #define CHAR_HEIGHT 20
-#define CHAR_WIDTH_ORIG 6
-#define CHAR_HEIGHT_ORIG 10
+#define CHAR_WIDTH_ORIG SAA5050_CHAR_WIDTH
+#define CHAR_HEIGHT_ORIG SAA5050_CHAR_HEIGHT
 #define OSKS_TOTAL_CHARS 36
 #define OSKS_HIGHLIGHT_XPOS 19
 #define OSKS_LINE_YPOS 23
 #define DEBOUNCE_NORMAL 30
 #define DEBOUNCE_FAST 5
 #define M2000_VARIABLE_KEYBOARD_MAPPING "m2000_keyboard_mapping"
+#define M2000_VARIABLE_RESOLUTION "m2000_resolution"
+#define M2000_VARIABLE_PIXEL_FORMAT "m2000_pixel_format"
+#define M2000_VARIABLE_MODEL "m2000_model"
+#define M2000_VARIABLE_SAMPLE_RATE "m2000_sample_rate"
+#define M2000_VARIABLE_WAV_CAPTURE "m2000_wav_capture"
+#define M2000_VARIABLE_LOADING_PICTURES "m2000_loading_pictures"
+#define M2000_VARIABLE_TAPE_TURBO "m2000_tape_turbo"
+#define M2000_VARIABLE_TAPE_OVERLAY "m2000_tape_overlay"
+#define WAV_FILENAME "m2000.wav" /* sound capture, in the Saves folder */
 #ifndef MAX_PATH
 #define MAX_PATH 260
 #endif
 
-static uint32_t *frame_buf;
+static void *frame_buf;
 static byte *font_buf;
 static byte *osks_display;
-static signed char *sound_buf = NULL;
+static short *sound_buf = NULL;
 static int16_t *audio_batch_buf;
 static struct retro_log_callback logging;
 static retro_log_printf_t log_cb;
 static int *display_char_buf;
 static int buf_size;
+static int sample_rate = SAMPLE_RATE;
 static Z80_Regs registers;
 static bool osks_visible = false;
+static bool can_dupe = false;
+static bool frame_changed = true;
 static int osks_index = 0;
 static char default_cas_path[MAX_PATH];
+static char wav_path[MAX_PATH];
+static char overlay_path[MAX_PATH];
+static WavWriter *wav = NULL;
 static enum keyboard_mapping_mode keyboard_mode = SYMBOLIC;
+static enum retro_pixel_format pixel_format = RETRO_PIXEL_FORMAT_XRGB8888;
+static enum retro_pixel_format requested_pixel_format = RETRO_PIXEL_FORMAT_XRGB8888;
+static int char_width = CHAR_WIDTH;   /* CHAR_WIDTH_ORIG in native mode  */
+static int char_height = CHAR_HEIGHT; /* CHAR_HEIGHT_ORIG in native mode */
+static int video_width = 40 * CHAR_WIDTH;
+static int video_height = VIDEO_BUFFER_HEIGHT;
 
 static retro_video_refresh_t video_cb;
 static retro_audio_sample_t audio_cb;
@@ -99,107 +123,41 @@ void Pause(int ms)
 }
 
 /****************************************************************************/
-/*** This function creates the SAA5050 font with character rounding       ***/
+/*** This function creates the SAA5050 font, with character rounding when ***/
+/*** not in native mode                                                   ***/
 /****************************************************************************/
 int LoadFont(const char *filename)
 {
-   byte *font_ptr = font_buf;
-   int line_pixels_prev, line_pixels, line_pixels_next;
-   int pixel_n, pixel_e, pixel_s, pixel_w, pixel_sw, pixel_se, pixel_nw, pixel_ne;
-
-   /* Stretch 6x10 characters to 12x20, so we can do character rounding  */
-   /* 96 alphanum chars + 64 cont. graphic chars + 64 sep. graphic chars */
-   for (int i = 0; i < NUMBER_OF_CHARS * CHAR_HEIGHT_ORIG; i += CHAR_HEIGHT_ORIG) 
-   { 
-      line_pixels_prev = 0;
-      line_pixels = 0;
-      line_pixels_next = saa5050_fnt[i] << CHAR_WIDTH_ORIG;
-      for (int j = 0; j < CHAR_HEIGHT_ORIG; ++j) 
-      {
-         line_pixels_prev = line_pixels >> CHAR_WIDTH_ORIG;
-         line_pixels = line_pixels_next >> CHAR_WIDTH_ORIG;
-         line_pixels_next = j < (CHAR_HEIGHT_ORIG-1) ? saa5050_fnt[i + j + 1] : 0;
-         for (int k = 0; k < CHAR_WIDTH_ORIG; ++k)
-         {
-            if (line_pixels & 0x20) /* bit 6 set = pixel set */
-            {
-               *font_ptr = *(font_ptr+1) = *(font_ptr+CHAR_WIDTH) = 
-                  *(font_ptr+CHAR_WIDTH+1) = 0xff;
-            }
-            /* character rounding (only for alphanumeric chars) */
-            else if (i < 96 * CHAR_HEIGHT_ORIG)
-            { 
-               /* for character rounding, look at 8 pixels around current pixel */
-               pixel_n  = line_pixels_prev & 0x20;
-               pixel_e  = line_pixels      & 0x10;
-               pixel_s  = line_pixels_next & 0x20;
-               pixel_w  = line_pixels      & 0x40;
-               pixel_ne = line_pixels_prev & 0x10;
-               pixel_se = line_pixels_next & 0x10;
-               pixel_sw = line_pixels_next & 0x40;
-               pixel_nw = line_pixels_prev & 0x40;
-
-               /* rounding in NW direction */
-               if (pixel_n && pixel_w && !pixel_nw) *font_ptr = 0xff;
-               /* rounding in NE direction */
-               if (pixel_n && pixel_e && !pixel_ne) *(font_ptr+1) = 0xff;
-               /* rounding in SE direction */
-               if (pixel_s && pixel_e && !pixel_se) *(font_ptr+CHAR_WIDTH+1) = 0xff;
-               /* rounding in SW direction */
-               if (pixel_s && pixel_w && !pixel_sw) *(font_ptr+CHAR_WIDTH) = 0xff;
-            }
-            /* process next pixel to the right */
-            font_ptr += 2;
-            line_pixels_prev<<=1;
-            line_pixels<<=1;
-            line_pixels_next<<=1;
-         }
-         font_ptr += CHAR_WIDTH;
-      }
-   }
-   memcpy(font_ptr, saa5050_fnt_extra, saa5050_fnt_extra_size);
-   return 1;
-}
-
-/****************************************************************************/
-/*** This function is called when the P2000T's sound register is written  ***/
-/****************************************************************************/
-void Sound(int toggle)
-{
-   static int last = -1;
-   int pos,val;
+   int scale = char_width / CHAR_WIDTH_ORIG;
+   byte *font_ptr = font_buf + NUMBER_OF_CHARS * char_width * char_height;
 
-   if (toggle != last) {
-      last = toggle;
-      pos  = (buf_size-1) - ((buf_size-1)*Z80_ICount/Z80_IPeriod);
-      val  =( toggle)? -1 : 1;
-      sound_buf[pos]=val;
+   SAA5050_BuildFont(saa5050_fnt, font_buf, scale);
+   if (scale == 2)
+   {
+      memcpy(font_ptr, saa5050_fnt_extra, saa5050_fnt_extra_size);
+      return 1;
    }
+
+   /* scale down the 12x20 extra (OSKS) chars by merging each 2x2 block */
+   for (int i = 0; i < saa5050_fnt_extra_size; i += CHAR_WIDTH * 2)
+      for (int k = 0; k < CHAR_WIDTH; k += 2)
+         *font_ptr++ = saa5050_fnt_extra[i + k] | saa5050_fnt_extra[i + k + 1] |
+            saa5050_fnt_extra[i + k + CHAR_WIDTH] | saa5050_fnt_extra[i + k + CHAR_WIDTH + 1];
+   return 1;
 }
 
 /****************************************************************************/
-/*** This function is called every interrupt to flush sound pipes and     ***/
-/*** sync emulation                                                       ***/
+/*** This function is called every interrupt to render the beeper samples ***/
 /****************************************************************************/
 void FlushSound(void)
 {
-   static int sound_state = 0;
-   static int smooth = 0;
-
+   Beeper_Render(sound_buf, 1024);
    for (int i=0; i<buf_size; ++i) 
-   {
-      if (sound_buf[i]) 
-      {
-         sound_state = sound_buf[i] << 10;
-         sound_buf[i] = 0;
-      }
-      /* low pass filtering */
-      smooth = (smooth << 1) + sound_state - smooth; 
-      smooth >>= 1;
-      audio_batch_buf[2*i] = audio_batch_buf[2*i+1] = smooth;
-   }
-   sound_state >>= 1;
+      audio_batch_buf[2*i] = audio_batch_buf[2*i+1] = sound_buf[i];
    audio_batch_cb(audio_batch_buf, buf_size);
+   /* never blocks; a writer thread takes the samples to disk */
+   if (wav)
+      WavWriter_Write(wav, sound_buf, buf_size, 0);
 }
 
 /****************************************************************************/
@@ -393,7 +351,7 @@ void PutChar(int x, int y, int c, int fg, int bg, int si)
    /* check if we need to display OSKS on bottom line */
    if (osks_visible && y == OSKS_LINE_YPOS) 
    {
-      c = osks_display[x];
+      c = x < 40 ? osks_display[x] : 0;
       fg = P2000T_BLACK;
       bg = x == OSKS_HIGHLIGHT_XPOS ? P2000T_YELLOW : P2000T_CYAN;
       si = 0;
@@ -401,22 +359,36 @@ void PutChar(int x, int y, int c, int fg, int bg, int si)
 
    int display_char = c + (fg << 8) + (bg << 16) + (si << 24);
    /* skip if character is already on screen */
-   if (display_char == display_char_buf[y * 40 + x])
+   if (display_char == display_char_buf[y * 80 + x])
       return;
 
-   display_char_buf[y * 40 + x] = display_char;
-   byte *font_buf_ptr = font_buf + c * CHAR_WIDTH * CHAR_HEIGHT + (si >> 1) * CHAR_WIDTH * CHAR_HEIGHT/2;
+   display_char_buf[y * 80 + x] = display_char;
+   frame_changed = true;
 
-   for (int j = 0; j < CHAR_HEIGHT; j++)
-   {
-      for (int i = 0; i < CHAR_WIDTH; i++)
-      {
-         frame_buf[(x * CHAR_WIDTH + i) + (y * CHAR_HEIGHT + j) * VIDEO_BUFFER_WIDTH] = 
-            *font_buf_ptr++ ? pal_xrgb[fg] : pal_xrgb[bg];
-      }
-      if (si && (j & 1) == 0)
-         font_buf_ptr -= CHAR_WIDTH;
-   }
+   if (pixel_format == RETRO_PIXEL_FORMAT_RGB565)
+      SAA5050_PutChar(frame_buf, video_width, 16, font_buf, char_width / CHAR_WIDTH_ORIG,
+         x, y, c, pal_rgb565[fg], pal_rgb565[bg], si);
+   else
+      SAA5050_PutChar(frame_buf, video_width, 32, font_buf, char_width / CHAR_WIDTH_ORIG,
+         x, y, c, pal_xrgb[fg], pal_xrgb[bg], si);
+}
+
+/****************************************************************************/
+/*** Clear the display buffer, which equals a screen of black spaces      ***/
+/****************************************************************************/
+static void clear_display(void)
+{
+   memset(frame_buf, 0, VIDEO_BUFFER_WIDTH * VIDEO_BUFFER_HEIGHT * sizeof(uint32_t));
+   memset(display_char_buf, 0, 80 * 24 * sizeof(int));
+   frame_changed = true;
+}
+
+/****************************************************************************/
+/*** Draw the video snapshot straight away, on the emulation thread       ***/
+/****************************************************************************/
+void PutScreen(const VideoState *V)
+{
+   DrawScreen(V);
 }
 
 /****************************************************************************/
@@ -424,7 +396,15 @@ void PutChar(int x, int y, int c, int fg, int bg, int si)
 /****************************************************************************/
 void PutImage (void)
 {
-   video_cb(frame_buf, VIDEO_BUFFER_WIDTH, VIDEO_BUFFER_HEIGHT, VIDEO_BUFFER_WIDTH << 2);
+   /* let the frontend reuse the previous frame if nothing has changed */
+   if (can_dupe && !frame_changed)
+   {
+      video_cb(NULL, video_width, video_height, 0);
+      return;
+   }
+   frame_changed = false;
+   int bytes_per_pixel = pixel_format == RETRO_PIXEL_FORMAT_RGB565 ? 2 : 4;
+   video_cb(frame_buf, video_width, video_height, video_width * bytes_per_pixel);
 }
 
 /* ========================================================================== */
@@ -434,11 +414,34 @@ void PutImage (void)
 void retro_init(void)
 {
    /* log_cb(RETRO_LOG_INFO, "retro_init called\n"); */
+   /* the model determines the memory map, so it is only read at startup */
+   struct retro_variable var = { M2000_VARIABLE_MODEL, NULL };
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      P2000Model = !strcmp(var.value, "P2000M") ? P2000_M : P2000_T;
+   /* as is the sample rate, which can be lowered for weak devices */
+   var.key = M2000_VARIABLE_SAMPLE_RATE;
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      sample_rate = atoi(var.value);
+   video_width = P2000_COLUMNS * char_width;
    frame_buf = calloc(VIDEO_BUFFER_WIDTH * VIDEO_BUFFER_HEIGHT, sizeof(uint32_t));
    font_buf = calloc(NUMBER_OF_CHARS * CHAR_WIDTH * CHAR_HEIGHT + saa5050_fnt_extra_size, sizeof(byte));
    display_char_buf = calloc(80 * 24, sizeof(int));
-   buf_size = SAMPLE_RATE / IFreq;
-   sound_buf = calloc(buf_size, sizeof(char));
+   buf_size = sample_rate / IFreq;
+   sound_buf = calloc(buf_size, sizeof(short));
+   Beeper_Init(buf_size);
+   /* the sound can be recorded to the Saves folder */
+   const char *saves_dir = NULL;
+   var.key = M2000_VARIABLE_WAV_CAPTURE;
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && !strcmp(var.value, "enabled") &&
+       environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &saves_dir) && saves_dir)
+   {
+      snprintf(wav_path, sizeof(wav_path), "%s%c%s", saves_dir, PATH_DEFAULT_SLASH_C(), WAV_FILENAME);
+      WavName = wav_path;
+      if (!(wav = WavWriter_Open(WavName, buf_size * IFreq)))
+         log_cb(RETRO_LOG_ERROR, "Could not create %s\n", WavName);
+   }
    audio_batch_buf = calloc(buf_size * 2, sizeof(int16_t)); /* * 2 for stereo */
    osks_display = calloc(OSKS_TOTAL_CHARS, sizeof(char));
    InitP2000(monitor_rom, basic_nl_rom);
@@ -448,8 +451,12 @@ void retro_init(void)
 void retro_deinit(void)
 {
    TrashP2000();
+   if (wav && !WavWriter_Close(wav))
+      log_cb(RETRO_LOG_WARN, "Could not write all the sound to %s\n", WavName);
+   wav = NULL;
    free(frame_buf);
    free(font_buf);
+   Beeper_Trash();
    free(sound_buf);
    free(audio_batch_buf);
    free(display_char_buf);
@@ -471,24 +478,29 @@ void retro_get_system_info(struct retro_system_info *info)
    memset(info, 0, sizeof(*info));
    info->library_name     = "M2000";
    info->library_version  = "v0.9.3";
-   info->need_fullpath    = true;
-   info->valid_extensions = "cas";
+   info->need_fullpath    = false; /* cassettes are loaded from memory */
+   info->valid_extensions = "cas|gz";
+}
+
+static void get_geometry(struct retro_game_geometry *geometry)
+{
+   *geometry = (struct retro_game_geometry) {
+      .base_width   = video_width,
+      .base_height  = video_height,
+      .max_width    = VIDEO_BUFFER_WIDTH,
+      .max_height   = VIDEO_BUFFER_HEIGHT,
+      .aspect_ratio =  4.0f / 3.0f,
+   };
 }
 
 void retro_get_system_av_info(struct retro_system_av_info *info)
 {
    info->timing = (struct retro_system_timing) {
       .fps = 50.0,
-      .sample_rate = (float)SAMPLE_RATE,
+      .sample_rate = (float)(buf_size * IFreq),
    };
 
-   info->geometry = (struct retro_game_geometry) {
-      .base_width   = VIDEO_BUFFER_WIDTH,
-      .base_height  = VIDEO_BUFFER_HEIGHT,
-      .max_width    = VIDEO_BUFFER_WIDTH,
-      .max_height   = VIDEO_BUFFER_HEIGHT,
-      .aspect_ratio =  4.0f / 3.0f,
-   };
+   get_geometry(&info->geometry);
 }
 
 static void fallback_log(enum retro_log_level level, const char *fmt, ...)
@@ -510,6 +522,48 @@ static void update_variables(void)
    {
       keyboard_mode = !strcmp(var.value, "positional") ? POSITIONAL : SYMBOLIC;
    }
+
+   var.key = M2000_VARIABLE_RESOLUTION;
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      int native = !strcmp(var.value, "240x240");
+      if (native != (char_width == CHAR_WIDTH_ORIG))
+      {
+         char_width = native ? CHAR_WIDTH_ORIG : CHAR_WIDTH;
+         char_height = native ? CHAR_HEIGHT_ORIG : CHAR_HEIGHT;
+         video_width = P2000_COLUMNS * char_width;
+         video_height = 24 * char_height;
+         LoadFont(NULL);
+         clear_display();
+         struct retro_game_geometry geometry;
+         get_geometry(&geometry);
+         environ_cb(RETRO_ENVIRONMENT_SET_GEOMETRY, &geometry);
+      }
+   }
+
+   /* the pixel format can only be changed when loading content */
+   var.key = M2000_VARIABLE_PIXEL_FORMAT;
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      requested_pixel_format = !strcmp(var.value, "RGB565") 
+         ? RETRO_PIXEL_FORMAT_RGB565 : RETRO_PIXEL_FORMAT_XRGB8888;
+   }
+
+   var.key = M2000_VARIABLE_LOADING_PICTURES;
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      TapeLoadDelay = !strcmp(var.value, "instant") ? 0 : 10;
+   }
+
+   var.key = M2000_VARIABLE_TAPE_TURBO;
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      TapeTurbo = !strcmp(var.value, "enabled");
+   }
 }
 
 void retro_set_environment(retro_environment_t cb)
@@ -523,6 +577,14 @@ void retro_set_environment(retro_environment_t cb)
     /* provide core variables to frontend */
    static struct retro_variable variables[] = {
       { M2000_VARIABLE_KEYBOARD_MAPPING, "Keyboard mapping; symbolic|positional" },
+      { M2000_VARIABLE_RESOLUTION, "Display resolution; 480x480|240x240" },
+      { M2000_VARIABLE_PIXEL_FORMAT, "Pixel format (restart); XRGB8888|RGB565" },
+      { M2000_VARIABLE_MODEL, "Model (restart); P2000T|P2000M" },
+      { M2000_VARIABLE_SAMPLE_RATE, "Audio sample rate (restart); 30000|22050|44100|48000" },
+      { M2000_VARIABLE_WAV_CAPTURE, "Record sound to " WAV_FILENAME " in Saves (restart); disabled|enabled" },
+      { M2000_VARIABLE_LOADING_PICTURES, "Loading pictures; animated|instant" },
+      { M2000_VARIABLE_TAPE_TURBO, "Turbo tape loading; enabled|disabled" },
+      { M2000_VARIABLE_TAPE_OVERLAY, "Save to cassettes, changes kept in Saves (restart); enabled|disabled" },
       { NULL, NULL },
    };
    environ_cb(RETRO_ENVIRONMENT_SET_VARIABLES, variables);
@@ -548,10 +610,45 @@ void retro_run(void)
    if(environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
       update_variables();
 
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe))
+      can_dupe = false;
+
    /* execute a period of Z80 emulation */
    Z80_Execute();
 }
 
+/* writes to a read-only cassette go to <name>.<hash>.cow in the Saves
+ * folder, the hash being that of the path, so cassettes of the same name
+ * in different folders don't share their saves */
+static void set_overlay_path(const char *path)
+{
+   struct retro_variable var = { M2000_VARIABLE_TAPE_OVERLAY, NULL };
+   const char *saves_dir = NULL, *name, *p;
+   uint32_t hash = 2166136261u; /* FNV-1a */
+   int len, i;
+
+   TapeOverlayName = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && !strcmp(var.value, "disabled"))
+      return;
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &saves_dir) || !saves_dir)
+      return;
+   /* strip the folder, archive and extension off the name */
+   name = path ? path : "cassette.cas";
+   for (p = name; *p; ++p)
+      if (*p == '/' || *p == '\\' || *p == '#') name = p + 1;
+   len = (p = strrchr(name, '.')) ? (int)(p - name) : (int)strlen(name);
+   /* game.cas.gz shares its overlay with game.cas */
+   if (p && (p[1] | 0x20) == 'g' && (p[2] | 0x20) == 'z' && !p[3])
+   {
+      for (i = len; i > 0 && name[i - 1] != '.'; --i);
+      if (i > 0) len = i - 1;
+   }
+   for (p = path ? path : name; p < name + len; ++p)
+      hash = (hash ^ (uint8_t)*p) * 16777619u;
+   snprintf(overlay_path, sizeof(overlay_path), "%s%c%.*s.%08x.cow", saves_dir, PATH_DEFAULT_SLASH_C(), len, name, (unsigned)hash);
+   TapeOverlayName = overlay_path;
+}
+
 bool retro_load_game(const struct retro_game_info *info)
 {
    static const struct retro_input_descriptor desc[] = {
@@ -568,15 +665,32 @@ bool retro_load_game(const struct retro_game_info *info)
    };
    environ_cb(RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS, (void*)desc);
 
-   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
-   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+   update_variables();
+
+   /* use the requested pixel format, or else fall back to the other one */
+   pixel_format = requested_pixel_format;
+   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &pixel_format))
    {
-      log_cb(RETRO_LOG_INFO, "XRGB8888 is not supported.\n");
-      return false;
+      pixel_format = pixel_format == RETRO_PIXEL_FORMAT_RGB565 
+         ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+      if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &pixel_format))
+      {
+         log_cb(RETRO_LOG_INFO, "Neither XRGB8888 nor RGB565 is supported.\n");
+         return false;
+      }
    }
+   clear_display();
 
-   /* if path to .cas game is given, load it read-only */
-   if (info && info->path) 
+   /* if a .cas game is given, load it read-only; the frontend normally */
+   /* passes its contents, which may come from an archive              */
+   if (info && (info->data || info->path))
+      set_overlay_path(info->path);
+   if (info && info->data) 
+   {
+      TapeBootEnabled = 1;
+      InsertCassetteData(info->path ? info->path : "cassette.cas", info->data, info->size, true);
+   }
+   else if (info && info->path) 
    {
       TapeBootEnabled = 1;
       InsertCassette(info->path, fopen(info->path, "rb"), true);
@@ -600,6 +714,7 @@ bool retro_load_game(const struct retro_game_info *info)
 void retro_unload_game(void)
 {
    RemoveCassette();
+   TapeOverlayName = NULL;
 }
 
 unsigned retro_get_region(void)
@@ -339,4 +339,16 @@ uint32_t pal_xrgb[8] =     /* SAA5050 palette                       */
   0x00FF00FF, //magenta
   0x0000FFFF, //cyan
   0x00FFFFFF  //white
+};
+
+uint16_t pal_rgb565[8] =   /* SAA5050 palette in RGB565 format      */
+{
+  0x0000, //black
+  0xF800, //red
+  0x07E0, //green
+  0xFFE0, //yellow
+  0x001F, //blue
+  0xF81F, //magenta
+  0x07FF, //cyan
+  0xFFFF  //white
 };
\ No newline at end of file
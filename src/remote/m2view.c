@@ -0,0 +1,185 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the reference remote display viewer. It connects to
+// the Unix domain socket set with the remote=<socket> option (or reads a
+// cell stream from stdin) and draws the cells with the SAA5050 rasteriser.
+// Build with: gcc -O2 -o m2view m2view.c ../CellStream.c ../SAA5050.c
+//             -lallegro
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <allegro5/allegro.h>
+#include "../CellStream.h"
+#include "../SAA5050.h"
+
+#define SCALE 2                 /* 12x20 pixels per character cell         */
+
+static CellStreamInfo Info;
+static byte Glyphs[SAA5050_CHARS*SAA5050_CHAR_WIDTH*SAA5050_CHAR_HEIGHT*SCALE*SCALE];
+static dword Colours[8];
+static int Width, Height;
+static dword *Frame;
+
+/****************************************************************************/
+/*** Connect to the emulator. Returns -1 in case of a failure             ***/
+/****************************************************************************/
+static int Connect(const char *path)
+{
+  struct sockaddr_un Address;
+  int fd;
+
+  if (!strcmp(path, "-"))
+    return 0;
+  if (strlen(path) >= sizeof(Address.sun_path))
+    return -1;
+  memset(&Address, 0, sizeof(Address));
+  Address.sun_family = AF_UNIX;
+  strcpy(Address.sun_path, path);
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    return -1;
+  if (connect(fd, (struct sockaddr *)&Address, sizeof(Address)))
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/****************************************************************************/
+/*** Draw the cells that changed and copy the picture to the display      ***/
+/****************************************************************************/
+static void DrawFrame(const int *Cells, int *Drawn, ALLEGRO_BITMAP *Bitmap)
+{
+  ALLEGRO_LOCKED_REGION *R;
+  int i, k, y;
+
+  for (i = 0; i < Info.Columns * Info.Rows; ++i)
+    if ((k = Cells[i]) != Drawn[i])
+    {
+      SAA5050_PutChar(Frame, Width, 32, Glyphs, SCALE, i % Info.Columns,
+                      i / Info.Columns, CELL_CHAR(k), Colours[CELL_FG(k)],
+                      Colours[CELL_BG(k)], CELL_SI(k));
+      Drawn[i] = k;
+    }
+  if (!(R = al_lock_bitmap(Bitmap, ALLEGRO_PIXEL_FORMAT_ARGB_8888, ALLEGRO_LOCK_WRITEONLY)))
+    return;
+  for (y = 0; y < Height; ++y)
+    memcpy((byte *)R->data + y * R->pitch, Frame + y * Width, Width * sizeof(dword));
+  al_unlock_bitmap(Bitmap);
+  al_draw_bitmap(Bitmap, 0, 0, 0);
+  al_flip_display();
+}
+
+int main(int argc, char *argv[])
+{
+  const char *FontName = "Default.fnt";
+  byte Font[SAA5050_FONT_SIZE];
+  int Cells[CELLSTREAM_MAX_CELLS], Drawn[CELLSTREAM_MAX_CELLS];
+  ALLEGRO_DISPLAY *Display;
+  ALLEGRO_BITMAP *Bitmap;
+  ALLEGRO_EVENT_QUEUE *Queue;
+  ALLEGRO_EVENT Event;
+  struct pollfd P;
+  FILE *In, *F;
+  int i, fd, n, quit;
+
+  if (argc == 4 && !strcmp(argv[1], "-font"))
+    FontName = argv[2];
+  else if (argc != 2)
+  {
+    fprintf(stderr, "m2view: M2000 remote display viewer\n"
+            "Usage: m2view [-font <file>] <socket>|-\n");
+    return 1;
+  }
+  if (!(F = fopen(FontName, "rb")) || fread(Font, sizeof(Font), 1, F) != 1)
+  {
+    fprintf(stderr, "Cannot read font %s\n", FontName);
+    return 2;
+  }
+  fclose(F);
+  if ((fd = Connect(argv[argc - 1])) < 0 || !(In = fdopen(fd, "rb")))
+  {
+    fprintf(stderr, "Cannot connect to %s\n", argv[argc - 1]);
+    return 3;
+  }
+  // unbuffered, so poll() tells if a record is waiting
+  setvbuf(In, NULL, _IONBF, 0);
+  if (!CellStream_ReadHeader(In, &Info))
+  {
+    fprintf(stderr, "%s does not send a cell stream\n", argv[argc - 1]);
+    return 3;
+  }
+
+  SAA5050_BuildFont(Font, Glyphs, SCALE);
+  for (i = 0; i < 8; ++i)
+    Colours[i] = 0xFF000000 | (Info.Palette[3*i] << 16) |
+                 (Info.Palette[3*i+1] << 8) | Info.Palette[3*i+2];
+  Width = Info.Columns * SAA5050_CHAR_WIDTH * SCALE;
+  Height = Info.Rows * SAA5050_CHAR_HEIGHT * SCALE;
+  Frame = calloc(Width * Height, sizeof(dword));
+  for (i = 0; i < CELLSTREAM_MAX_CELLS; ++i)
+  {
+    Cells[i] = CELL(0, 7, 0, 0);
+    Drawn[i] = -1;              // draw every cell on the first frame
+  }
+
+  if (!Frame || !al_init() || !(Display = al_create_display(Width, Height)) ||
+      !(Bitmap = al_create_bitmap(Width, Height)) || !(Queue = al_create_event_queue()))
+  {
+    fprintf(stderr, "Cannot open a %dx%d display\n", Width, Height);
+    return 4;
+  }
+  al_set_window_title(Display, "M2000 remote display");
+  al_register_event_source(Queue, al_get_display_event_source(Display));
+
+  P.fd = fd;
+  P.events = POLLIN;
+  for (quit = 0; !quit; )
+  {
+    while (al_get_next_event(Queue, &Event))
+      if (Event.type == ALLEGRO_EVENT_DISPLAY_CLOSE)
+        quit = 1;
+    if (poll(&P, 1, 20) <= 0)
+      continue;
+    // draw the latest frame only, when several are waiting
+    n = 0;
+    do
+    {
+      if ((i = CellStream_ReadFrame(In, &Info, Cells)) < 0)
+        quit = 1;
+      else
+        n += i;
+    } while (!quit && poll(&P, 1, 0) > 0);
+    if (n > 0 && !quit)
+      DrawFrame(Cells, Drawn, Bitmap);
+  }
+
+  fclose(In);
+  al_destroy_bitmap(Bitmap);
+  al_destroy_event_queue(Queue);
+  al_destroy_display(Display);
+  free(Frame);
+  return 0;
+}
@@ -0,0 +1,88 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+/*
+    P2000 Keyboard layout
+
+    Y \ X   0       1        2       3        4       5        6       7
+    0       LEFT    6        UP      Q        3       5        7       4
+    1       TAB     H        Z       S        D       G        J       F
+    2       . *     SPACE    00 *    0 *      #       DOWN     ,       RIGHT
+    3       SHLOCK  N        <       X        C       B        M       V
+    4       CODE    Y        A       W        E       T        U       R
+    5       CLRLN * 9        + *     - *      BACKSP  0        1       -
+    6       9 *     O        8 *     7 *      ENTER   P        8       @
+    7       3 *     .        2 *     1 *      ->      /        K       2
+    8       6 *     L        5 *     4 *      1/4     ;        I       :
+    9       LSHIFT                                                     RSHIFT
+
+    Keys marked with an asterix (*) are on the numeric keypad
+*/
+
+#define KEY_SHIFT    0x80       /* Key must be pressed with LSHIFT        */
+#define KEY_LSHIFT   72
+#define KEY_UP       2
+#define KEY_DOWN     21
+#define KEY_LEFT     0
+#define KEY_RIGHT    23
+#define KEY_START    (56|KEY_SHIFT)
+#define KEY_STOP     (16|KEY_SHIFT)
+#define KEY_ZOEK     (59|KEY_SHIFT)
+
+/* P2000 key for every ASCII character typed, 0 if there is none */
+static const byte asciimap[128] =
+{
+  ['a'] = 34,   ['b'] = 29,   ['c'] = 28,   ['d'] = 12,   ['e'] = 36,
+  ['f'] = 15,   ['g'] = 13,   ['h'] =  9,   ['i'] = 70,   ['j'] = 14,
+  ['k'] = 62,   ['l'] = 65,   ['m'] = 30,   ['n'] = 25,   ['o'] = 49,
+  ['p'] = 53,   ['q'] =  3,   ['r'] = 39,   ['s'] = 11,   ['t'] = 37,
+  ['u'] = 38,   ['v'] = 31,   ['w'] = 35,   ['x'] = 27,   ['y'] = 33,
+  ['z'] = 10,
+  ['A'] = 34|KEY_SHIFT, ['B'] = 29|KEY_SHIFT, ['C'] = 28|KEY_SHIFT,
+  ['D'] = 12|KEY_SHIFT, ['E'] = 36|KEY_SHIFT, ['F'] = 15|KEY_SHIFT,
+  ['G'] = 13|KEY_SHIFT, ['H'] =  9|KEY_SHIFT, ['I'] = 70|KEY_SHIFT,
+  ['J'] = 14|KEY_SHIFT, ['K'] = 62|KEY_SHIFT, ['L'] = 65|KEY_SHIFT,
+  ['M'] = 30|KEY_SHIFT, ['N'] = 25|KEY_SHIFT, ['O'] = 49|KEY_SHIFT,
+  ['P'] = 53|KEY_SHIFT, ['Q'] =  3|KEY_SHIFT, ['R'] = 39|KEY_SHIFT,
+  ['S'] = 11|KEY_SHIFT, ['T'] = 37|KEY_SHIFT, ['U'] = 38|KEY_SHIFT,
+  ['V'] = 31|KEY_SHIFT, ['W'] = 35|KEY_SHIFT, ['X'] = 27|KEY_SHIFT,
+  ['Y'] = 33|KEY_SHIFT, ['Z'] = 10|KEY_SHIFT,
+  ['1'] = 46,   ['!'] = 46|KEY_SHIFT,
+  ['2'] = 63,   ['@'] = 55,
+  ['3'] =  4,   ['#'] = 20,
+  ['4'] =  7,   ['$'] =  7|KEY_SHIFT,
+  ['5'] =  5,   ['%'] =  5|KEY_SHIFT,
+  ['6'] =  1,   ['^'] = 55|KEY_SHIFT,
+  ['7'] =  6,   ['&'] =  1|KEY_SHIFT,
+  ['8'] = 54,   ['*'] = 71|KEY_SHIFT,
+  ['9'] = 41,   ['('] = 54|KEY_SHIFT,
+  ['0'] = 45,   [')'] = 41|KEY_SHIFT,
+  ['='] = 45|KEY_SHIFT, ['+'] = 42,
+  ['-'] = 47,   ['_'] = 47|KEY_SHIFT,
+  [';'] = 69,   [':'] = 71,
+  ['\''] = 6|KEY_SHIFT, ['"'] = 63|KEY_SHIFT,
+  [','] = 22,   ['<'] = 26,
+  ['.'] = 57,   ['>'] = 26|KEY_SHIFT,
+  ['/'] = 61,   ['?'] = 61|KEY_SHIFT,
+  [' '] = 17,
+  ['\t'] = 8,
+  ['\r'] = 52,  ['\n'] = 52,
+  [0x7F] = 44,  [0x08] = 44,    // backspace
+  [0x0C] = 40|KEY_SHIFT,        // ctrl-L: clear screen
+};
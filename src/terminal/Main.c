@@ -0,0 +1,525 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the ANSI terminal front end. It shows the screen with
+// Unicode characters and the 8 ANSI colours, so the emulator can be used
+// over SSH, and only sends the character cells that changed
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/stat.h>
+#include "../P2000.h"
+#include "../SAA5050.h"
+#include "../Beeper.h"
+#include "../WavWriter.h"
+#include "Keyboard.h"
+
+#define KEY_HOLD      3         /* Interrupts a typed key is held down     */
+#define KEY_RELEASE   2         /* Interrupts between two typed keys       */
+#define WAV_RATE      44100     /* Sample rate of the sound capture        */
+#define WAV_AMPLITUDE 8191      /* Peak level of the sound capture         */
+#define KEY_QUEUE     256       /* Typed keys waiting to be pressed        */
+
+extern int M2000_main(int argc, char *argv[]);
+
+static char ProgramPath[FILENAME_MAX];
+static char DocumentPath[FILENAME_MAX];
+static const char *ProgramName;
+
+static struct termios OldTermios;
+static int TermiosSet = 0;
+static volatile sig_atomic_t Redraw = 1;
+
+static char Glyphs[SAA5050_CHARS][5];   /* UTF-8 string of every glyph   */
+static int Screen[80*24];               /* Cell cache: c|fg<<8|bg<<16|si<<24 */
+static byte Changed[80*24];             /* 1 if the cell must be sent     */
+static int ChangeCount = 0;
+static char Out[80*24*24+64];           /* Escape sequences of a frame     */
+
+static byte KeyQueue[KEY_QUEUE];
+static int KeyHead = 0, KeyTail = 0;
+static int KeyCode = -1, KeyTimer = 0;
+
+static struct timespec NextSync;
+static int FrameLimit = 0;              /* Interrupts to run, 0 for no limit */
+static int Frames = 0;                  /* Interrupts run so far           */
+static int Headless = 0;                /* 1 if there is no terminal       */
+
+static WavWriter *Wav = NULL;           /* Sound capture, see WavName      */
+static short *SoundBuf = NULL;          /* Samples of one interrupt        */
+static int SoundSamples;                /* Samples per interrupt           */
+
+/* SAA5050 characters that differ from ASCII */
+static const struct { byte c; const char *s; } Specials[] =
+{
+  { '#', "\xC2\xA3" },          // pound
+  { '[', "\xE2\x86\x90" },      // left arrow
+  { '\\', "\xC2\xBD" },         // 1/2
+  { ']', "\xE2\x86\x92" },      // right arrow
+  { '^', "\xE2\x86\x91" },      // up arrow
+  { '_', "#" },
+  { '`', "\xE2\x94\x80" },      // horizontal bar
+  { '{', "\xC2\xBC" },          // 1/4
+  { '|', "\xE2\x80\x96" },      // double vertical bar
+  { '}', "\xC2\xBE" },          // 3/4
+  { '~', "\xC3\xB7" },          // divide
+  { 0x7F, "\xE2\x96\x88" },     // block
+};
+
+/****************************************************************************/
+/*** Put the UTF-8 encoding of Unicode character u in s                   ***/
+/****************************************************************************/
+static void PutUTF8(char *s, int u)
+{
+  if (u < 0x80)
+    *s++ = u;
+  else if (u < 0x10000)
+  {
+    *s++ = 0xE0 | (u >> 12);
+    *s++ = 0x80 | ((u >> 6) & 0x3F);
+    *s++ = 0x80 | (u & 0x3F);
+  }
+  else
+  {
+    *s++ = 0xF0 | (u >> 18);
+    *s++ = 0x80 | ((u >> 12) & 0x3F);
+    *s++ = 0x80 | ((u >> 6) & 0x3F);
+    *s++ = 0x80 | (u & 0x3F);
+  }
+  *s = '\0';
+}
+
+/****************************************************************************/
+/*** Restore the terminal. This is also called when the program exits     ***/
+/****************************************************************************/
+static void RestoreTerminal(void)
+{
+  static const char s[] = "\033[0m\033[?25h\033[?1049l";
+  if (!TermiosSet)
+    return;
+  if (write(STDOUT_FILENO, s, sizeof(s) - 1) < 0) { }
+  tcsetattr(STDIN_FILENO, TCSAFLUSH, &OldTermios);
+  fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) & ~O_NONBLOCK);
+  TermiosSet = 0;
+}
+
+static void OnSignal(int sig)
+{
+  if (sig == SIGWINCH)
+    Redraw = 1;
+  else
+    Z80_Running = 0;
+}
+
+/****************************************************************************/
+/*** Allocate resources needed by the terminal dependent code             ***/
+/****************************************************************************/
+int InitMachine(void)
+{
+  struct termios T;
+  struct sigaction A;
+
+  memset(&A, 0, sizeof(A));
+  A.sa_handler = OnSignal;
+  sigaction(SIGINT, &A, NULL);
+  sigaction(SIGTERM, &A, NULL);
+  sigaction(SIGHUP, &A, NULL);
+  sigaction(SIGWINCH, &A, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &NextSync);
+
+  if (WavName)
+  {
+    SoundSamples = WAV_RATE / IFreq;
+    SoundBuf = calloc(SoundSamples, sizeof(short));
+    if (!SoundBuf || !Beeper_Init(SoundSamples) ||
+        !(Wav = WavWriter_Open(WavName, SoundSamples * IFreq)))
+    {
+      ShowErrorMessage("Could not create %s", WavName);
+      return 0;
+    }
+  }
+
+  // a limited run, e.g. to record the sound in a script, needs no terminal
+  if (FrameLimit && (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)))
+  {
+    Headless = 1;
+    return 1;
+  }
+  if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO) ||
+      tcgetattr(STDIN_FILENO, &OldTermios))
+  {
+    ShowErrorMessage("%s must be run in a terminal", ProgramName);
+    return 0;
+  }
+  // raw input, but keep ctrl-C to quit
+  T = OldTermios;
+  T.c_iflag &= ~(ICRNL | IXON | ISTRIP | INPCK | BRKINT);
+  T.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+  T.c_cc[VMIN] = 0;
+  T.c_cc[VTIME] = 0;
+  tcsetattr(STDIN_FILENO, TCSAFLUSH, &T);
+  fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+  TermiosSet = 1;
+  atexit(RestoreTerminal);
+
+  // alternate screen, hide cursor
+  printf("\033[?1049h\033[?25l");
+  fflush(stdout);
+  return 1;
+}
+
+/****************************************************************************/
+/*** Deallocate all resources taken by InitMachine()                      ***/
+/****************************************************************************/
+void TrashMachine(void)
+{
+  RestoreTerminal();
+  if (Wav && !WavWriter_Close(Wav))
+    ShowErrorMessage("Could not write all the sound to %s", WavName);
+  Wav = NULL;
+  Beeper_Trash();
+  if (SoundBuf)
+    free(SoundBuf);
+  SoundBuf = NULL;
+}
+
+void ShowErrorMessage(const char *format, ...)
+{
+  va_list args;
+  RestoreTerminal();
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+/****************************************************************************/
+/*** Make the glyph table: ASCII for the alphanumeric characters and      ***/
+/*** Unicode sextants (U+1FB00..U+1FB3B) for the block graphics, both     ***/
+/*** contiguous and separated                                             ***/
+/****************************************************************************/
+int LoadFont(const char *filename)
+{
+  int i, v;
+
+  for (i = 0; i < 96; ++i)
+  {
+    Glyphs[i][0] = i + 32;
+    Glyphs[i][1] = '\0';
+  }
+  for (i = 0; i < sizeof(Specials) / sizeof(Specials[0]); ++i)
+    strcpy(Glyphs[Specials[i].c - 32], Specials[i].s);
+  for (i = 96; i < SAA5050_CHARS; ++i)
+  {
+    // bit 0..5 light the top left, top right, ... bottom right block
+    v = (i - 96) & 63;
+    if (v == 0)
+      strcpy(Glyphs[i], " ");
+    else if (v == 63)
+      PutUTF8(Glyphs[i], 0x2588);
+    else if (v == 21)
+      PutUTF8(Glyphs[i], 0x258C); // left half
+    else if (v == 42)
+      PutUTF8(Glyphs[i], 0x2590); // right half
+    else
+      PutUTF8(Glyphs[i], 0x1FB00 + v - 1 - (v > 21) - (v > 42));
+  }
+  return 1;
+}
+
+/****************************************************************************/
+/*** Put a character in the cell cache, if it changed                     ***/
+/****************************************************************************/
+void PutChar(int x, int y, int c, int fg, int bg, int si)
+{
+  int k, i = y * 80 + x;
+  // the bottom half of a double height character shows as a space, the
+  // top half shows the character
+  if (si == 2)
+    c = 0;
+  k = c | (fg << 8) | (bg << 16);
+  if (Screen[i] == k)
+    return;
+  Screen[i] = k;
+  if (!Changed[i])
+  {
+    Changed[i] = 1;
+    ++ChangeCount;
+  }
+}
+
+/****************************************************************************/
+/*** Draw the video snapshot straight away, on the emulation thread       ***/
+/****************************************************************************/
+void PutScreen(const VideoState *V)
+{
+  DrawScreen(V);
+}
+
+/****************************************************************************/
+/*** Send the changed cells to the terminal in a single write. The cursor ***/
+/*** is only moved and the colours are only set when needed               ***/
+/****************************************************************************/
+void PutImage(void)
+{
+  int x, y, i, k, n;
+  int cx = -1, cy = -1, colours = -1;
+  int columns = P2000_COLUMNS;
+  char *p = Out;
+
+  if (Redraw)
+  {
+    Redraw = 0;
+    p += sprintf(p, "\033[0m\033[2J");
+    for (i = ChangeCount = 0; i < 80 * 24; ++i)
+      if ((Changed[i] = (i % 80 < columns)))
+        ++ChangeCount;
+  }
+  if (!ChangeCount || Headless)
+    return;
+  for (y = 0; y < 24; ++y)
+    for (x = 0; x < columns; ++x)
+    {
+      i = y * 80 + x;
+      if (!Changed[i])
+        continue;
+      Changed[i] = 0;
+      k = Screen[i];
+      if (x != cx || y != cy)
+        p += sprintf(p, "\033[%d;%dH", y + 1, x + 1);
+      if ((k >> 8) != colours)
+      {
+        colours = k >> 8;
+        p += sprintf(p, "\033[3%d;4%dm", (k >> 8) & 7, (k >> 16) & 7);
+      }
+      n = strlen(Glyphs[k & 0xFF]);
+      memcpy(p, Glyphs[k & 0xFF], n);
+      p += n;
+      cx = x + 1;
+      cy = y;
+    }
+  ChangeCount = 0;
+  if (write(STDOUT_FILENO, Out, p - Out) < 0) { }
+}
+
+/****************************************************************************/
+/*** Queue a typed key                                                    ***/
+/****************************************************************************/
+static void QueueKey(int key)
+{
+  if ((KeyTail + 1) % KEY_QUEUE != KeyHead)
+  {
+    KeyQueue[KeyTail] = key;
+    KeyTail = (KeyTail + 1) % KEY_QUEUE;
+  }
+}
+
+/****************************************************************************/
+/*** Read the typed keys. A terminal has no key releases, so every key is ***/
+/*** pressed for KEY_HOLD interrupts (with LSHIFT pressed one interrupt   ***/
+/*** earlier if needed) and released for KEY_RELEASE interrupts           ***/
+/****************************************************************************/
+void Keyboard(void)
+{
+  unsigned char buf[64];
+  int i, n, key;
+
+  n = Headless ? 0 : read(STDIN_FILENO, buf, sizeof(buf));
+  for (i = 0; i < n; ++i)
+  {
+    if (buf[i] == 0x11) // ctrl-Q
+      Z80_Running = 0;
+    else if (buf[i] == 0x1B && i + 2 < n && (buf[i+1] == '[' || buf[i+1] == 'O'))
+    {
+      // cursor keys and F1..F3 for <START>, <STOP> and <ZOEK>
+      switch (buf[i+2])
+      {
+        case 'A': QueueKey(KEY_UP); break;
+        case 'B': QueueKey(KEY_DOWN); break;
+        case 'C': QueueKey(KEY_RIGHT); break;
+        case 'D': QueueKey(KEY_LEFT); break;
+        case 'P': QueueKey(KEY_START); break;
+        case 'Q': QueueKey(KEY_STOP); break;
+        case 'R': QueueKey(KEY_ZOEK); break;
+      }
+      // skip the rest of the sequence
+      for (i += 2; i < n - 1 && buf[i] >= '0' && buf[i] <= '9'; ++i);
+      while (i < n - 1 && buf[i] == ';')
+        for (++i; i < n - 1 && buf[i] >= '0' && buf[i] <= '9'; ++i);
+    }
+    else if (buf[i] < 0x80 && (key = asciimap[buf[i]]))
+      QueueKey(key);
+  }
+
+  for (i = 0; i < 10; ++i)
+    KeyMap[i] = 0xFF;
+  if (KeyCode < 0)
+  {
+    if (KeyHead == KeyTail)
+      return;
+    KeyCode = KeyQueue[KeyHead];
+    KeyHead = (KeyHead + 1) % KEY_QUEUE;
+    KeyTimer = 0;
+  }
+  ++KeyTimer;
+  key = KeyCode & ~KEY_SHIFT;
+  if (KeyTimer <= 1 + KEY_HOLD && (KeyCode & KEY_SHIFT))
+    KeyMap[KEY_LSHIFT / 8] &= ~(1 << (KEY_LSHIFT % 8));
+  if (KeyTimer > 1 && KeyTimer <= 1 + KEY_HOLD)
+    KeyMap[key / 8] &= ~(1 << (key % 8));
+  if (KeyTimer == 1 + KEY_HOLD + KEY_RELEASE)
+    KeyCode = -1;
+}
+
+/****************************************************************************/
+/*** There is no sound in the terminal, but it can be recorded. Without   ***/
+/*** sync, the recording waits for the disk rather than drop samples      ***/
+/****************************************************************************/
+void FlushSound(void)
+{
+  if (!Wav)
+    return;
+  Beeper_Render(SoundBuf, WAV_AMPLITUDE);
+  WavWriter_Write(Wav, SoundBuf, SoundSamples, !Sync);
+}
+
+/****************************************************************************/
+/*** Sync emulation by sleeping until the next interrupt is due           ***/
+/****************************************************************************/
+void SyncEmulation(void)
+{
+  struct timespec now, t;
+  long ns;
+  if (FrameLimit && ++Frames >= FrameLimit)
+    Z80_Running = 0;
+  if (!Sync || TapeStreaming)
+    return;
+  NextSync.tv_nsec += 1000000000L / IFreq;
+  if (NextSync.tv_nsec >= 1000000000L)
+  {
+    NextSync.tv_nsec -= 1000000000L;
+    ++NextSync.tv_sec;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ns = (NextSync.tv_sec - now.tv_sec) * 1000000000L + NextSync.tv_nsec - now.tv_nsec;
+  // lagged behind more than a second: don't try to catch up
+  if (ns < -1000000000L)
+    NextSync = now;
+  else if (ns > 0)
+  {
+    t.tv_sec = ns / 1000000000L;
+    t.tv_nsec = ns % 1000000000L;
+    nanosleep(&t, NULL);
+  }
+}
+
+void Pause(int ms)
+{
+  struct timespec t = { ms / 1000, (ms % 1000) * 1000000L };
+  nanosleep(&t, NULL);
+}
+
+/****************************************************************************/
+/*** The ROM and font files are next to the executable                    ***/
+/****************************************************************************/
+char *GetResourcesPath(void)
+{
+  char *p;
+  strcpy(ProgramPath, "./");
+  if ((p = strrchr(ProgramName, '/')))
+    sprintf(ProgramPath, "%.*s/", (int)(p - ProgramName), ProgramName);
+
+  // debian install check
+  if (!strcmp(ProgramPath, "/usr/bin/"))
+    strcpy(ProgramPath, "/usr/share/M2000/");
+  return ProgramPath;
+}
+
+/****************************************************************************/
+/*** The cassettes are in Documents/M2000, like the Allegro front end     ***/
+/****************************************************************************/
+char *GetDocumentsPath(void)
+{
+  struct stat st;
+  const char *home = getenv("HOME");
+  strcpy(DocumentPath, GetResourcesPath()); //fallback to program path
+  if (home && strlen(home) < FILENAME_MAX - 20)
+  {
+    sprintf(DocumentPath, "%s/Documents/M2000/", home);
+    if (stat(DocumentPath, &st) || !S_ISDIR(st.st_mode))
+      strcpy(DocumentPath, ProgramPath);
+  }
+  return DocumentPath;
+}
+
+int main(int argc, char *argv[])
+{
+  ProgramName = argv[0];
+  // options before the optional cassette or cartridge name
+  while (argc > 1 && argv[1][0] == '-')
+  {
+    if (!strcmp(argv[1], "-m"))
+      P2000Model = P2000_M;
+    else if (!strcmp(argv[1], "-nosync"))
+      Sync = 0;
+    else if (!strcmp(argv[1], "-instant"))
+      TapeLoadDelay = 0;
+    else if (!strcmp(argv[1], "-noturbo"))
+      TapeTurbo = 0;
+    else if (!strcmp(argv[1], "-wav") && argc > 2)
+    {
+      WavName = argv[2];
+      argv[1] = argv[0];
+      ++argv;
+      --argc;
+    }
+    else if (!strcmp(argv[1], "-frames") && argc > 2 && atoi(argv[2]) > 0)
+    {
+      FrameLimit = atoi(argv[2]);
+      argv[1] = argv[0];
+      ++argv;
+      --argc;
+    }
+    else
+    {
+      printf("Usage: %s [-m] [-nosync] [-instant] [-noturbo] [-wav file] [-frames n] [filename]\n"
+             "  -m         emulate a P2000M (80 columns)\n"
+             "  -nosync    run as fast as possible\n"
+             "  -instant   show loading pictures at once\n"
+             "  -noturbo   load in real time when a program reads the tape itself\n"
+             "  -wav file  record the sound to a WAV file\n"
+             "  -frames n  quit after n interrupts; runs without a terminal\n"
+             "             when there is none\n"
+             "Type ctrl-Q to quit, F1/F2/F3 for <START>/<STOP>/<ZOEK>\n",
+             ProgramName);
+      return EXIT_FAILURE;
+    }
+    argv[1] = argv[0];
+    ++argv;
+    --argc;
+  }
+  return M2000_main(argc, argv);
+}
@@ -0,0 +1,177 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the tests of the gzip decompressor: single and
+// concatenated members, from memory and from a file, and the damaged or
+// cut off input that has to be refused. Run with: make test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../src/Gzip.h"
+
+#define STORED_SIZE 6000        /* Bytes in a stored member, over a chunk   */
+
+static int Failed = 0;
+
+#define CHECK(cond, ...) \
+  do { if (!(cond)) { printf("FAIL line %d: ", __LINE__); \
+                      printf(__VA_ARGS__); putchar('\n'); ++Failed; } } while (0)
+
+// "P2000T cassette, first member. " four times, compressed by gzip
+static const char TextA[] = "P2000T cassette, first member. ";
+static const byte MemberA[] = {
+  0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x0B, 0x30,
+  0x32, 0x30, 0x30, 0x08, 0x51, 0x48, 0x4E, 0x2C, 0x2E, 0x4E, 0x2D, 0x29,
+  0x49, 0xD5, 0x51, 0x48, 0xCB, 0x2C, 0x2A, 0x2E, 0x51, 0xC8, 0x4D, 0xCD,
+  0x4D, 0x4A, 0x2D, 0xD2, 0x53, 0x08, 0xA0, 0xA5, 0x34, 0x00, 0xA6, 0xE9,
+  0xCC, 0x0E, 0x7C, 0x00, 0x00, 0x00 };
+
+// "Second member of the same file." three times, compressed by gzip
+static const char TextB[] = "Second member of the same file.";
+static const byte MemberB[] = {
+  0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x0B, 0x4E,
+  0x4D, 0xCE, 0xCF, 0x4B, 0x51, 0xC8, 0x4D, 0xCD, 0x4D, 0x4A, 0x2D, 0x52,
+  0xC8, 0x4F, 0x53, 0x28, 0xC9, 0x48, 0x55, 0x28, 0x4E, 0xCC, 0x4D, 0x55,
+  0x48, 0xCB, 0xCC, 0x49, 0xD5, 0x0B, 0xA6, 0x48, 0x1A, 0x00, 0x64, 0xB2,
+  0xAA, 0xAA, 0x5D, 0x00, 0x00, 0x00 };
+
+static byte Input[2 * (sizeof(MemberA) + sizeof(MemberB)) + 4 * STORED_SIZE];
+static byte Expect[4 * STORED_SIZE];
+
+/****************************************************************************/
+/*** Append n copies of a string to buf at *len                           ***/
+/****************************************************************************/
+static void Repeat(byte *buf, long *len, const char *s, int n)
+{
+  while (n--) {
+    memcpy(buf + *len, s, strlen(s));
+    *len += strlen(s);
+  }
+}
+
+/****************************************************************************/
+/*** Append len bytes to buf at *pos                                      ***/
+/****************************************************************************/
+static void Append(byte *buf, long *pos, const void *data, long len)
+{
+  memcpy(buf + *pos, data, len);
+  *pos += len;
+}
+
+/****************************************************************************/
+/*** Append a gzip member of len bytes in one stored block to buf at *pos ***/
+/****************************************************************************/
+static void Stored(byte *buf, long *pos, const byte *data, int len)
+{
+  static const byte header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 3 };
+  dword crc = 0xFFFFFFFF;
+  byte b[5];
+  int i, j;
+
+  Append(buf, pos, header, sizeof(header));
+  b[0] = 1; // last block, stored
+  b[1] = len; b[2] = len >> 8; b[3] = ~len; b[4] = ~len >> 8;
+  Append(buf, pos, b, 5);
+  Append(buf, pos, data, len);
+  for (i = 0; i < len; ++i)
+    for (crc ^= data[i], j = 0; j < 8; ++j)
+      crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+  crc ^= 0xFFFFFFFF;
+  b[0] = crc; b[1] = crc >> 8; b[2] = crc >> 16; b[3] = crc >> 24;
+  Append(buf, pos, b, 4);
+  b[0] = len; b[1] = len >> 8; b[2] = 0; b[3] = 0;
+  Append(buf, pos, b, 4);
+}
+
+/****************************************************************************/
+/*** Decompress len bytes of input from memory and, through a temporary   ***/
+/*** file, from a file, and check that both give expect or, when it is    ***/
+/*** NULL, that both fail                                                 ***/
+/****************************************************************************/
+static void Check(const char *name, long len, const byte *expect, long size)
+{
+  byte *p;
+  long n;
+  FILE *F;
+  int pass;
+
+  for (pass = 0; pass < 2; ++pass) {
+    n = -1;
+    if (!pass)
+      p = Gzip_ReadData(Input, len, &n);
+    else if ((F = tmpfile())) {
+      fwrite(Input, 1, len, F);
+      rewind(F);
+      p = Gzip_ReadFile(F, &n);
+      fclose(F);
+    } else {
+      CHECK(0, "%s: no temporary file", name);
+      continue;
+    }
+    if (!expect)
+      CHECK(!p, "%s from %s is not refused", name, pass ? "file" : "memory");
+    else
+      CHECK(p && n == size && !memcmp(p, expect, size), "%s from %s gives %ld bytes, not %ld",
+            name, pass ? "file" : "memory", p ? n : -1, size);
+    free(p);
+  }
+}
+
+int main(void)
+{
+  long len, size, i;
+
+  // a single member
+  len = size = 0;
+  Append(Input, &len, MemberA, sizeof(MemberA));
+  Repeat(Expect, &size, TextA, 4);
+  Check("one member", len, Expect, size);
+
+  // two members, as cat a.gz b.gz makes them, unpack to both
+  Append(Input, &len, MemberB, sizeof(MemberB));
+  Repeat(Expect, &size, TextB, 3);
+  Check("two members", len, Expect, size);
+
+  // anything else after a member is refused
+  Input[len] = 0;
+  Check("a member and a zero", len + 1, NULL, 0);
+  Input[len] = 0x1F;
+  Input[len + 1] = 0x8B;
+  Check("a member and a partial header", len + 2, NULL, 0);
+  Check("a cut off member", len - 1, NULL, 0);
+  Input[len - 5] ^= 1;
+  Check("a member with a bad CRC", len, NULL, 0);
+  Input[len - 5] ^= 1;
+  Check("no input", 0, NULL, 0);
+
+  // members over more than one chunk of the input file
+  for (i = 0; i < 4 * STORED_SIZE; ++i)
+    Expect[i] = i * 7 + (i >> 8);
+  len = 0;
+  for (i = 0; i < 4; ++i)
+    Stored(Input, &len, Expect + i * STORED_SIZE, STORED_SIZE);
+  Check("four stored members", len, Expect, 4 * STORED_SIZE);
+
+  if (Failed)
+    printf("%d check%s failed\n", Failed, Failed == 1 ? "" : "s");
+  else
+    puts("Gzip tests passed");
+  return Failed != 0;
+}
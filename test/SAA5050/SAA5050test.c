@@ -0,0 +1,179 @@
+/******************************************************************************/
+/*                             M2000 - the Philips                            */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                ████████|████████|████████|████████|████████                */
+/*                ███||███|███||███|███||███|███||███|███||███                */
+/*                ███||███||||||███|███||███|███||███|███||███                */
+/*                ████████|||||███||███||███|███||███|███||███                */
+/*                ███|||||||||███|||███||███|███||███|███||███                */
+/*                ███|||||||███|||||███||███|███||███|███||███                */
+/*                ███||||||████████|████████|████████|████████                */
+/*                ||||||||||||||||||||||||||||||||||||||||||||                */
+/*                                  emulator                                  */
+/*                                                                            */
+/*   Copyright (C) 2023 by the M2000 team.                                    */
+/*                                                                            */
+/*   See the file "LICENSE" for information on usage and redistribution of    */
+/*   this file, and for a DISCLAIMER OF ALL WARRANTIES.                       */
+/******************************************************************************/
+
+// This file contains the tests of the SAA5050 rasteriser: the character
+// rounding of SAA5050_Quadrants(), the glyphs of SAA5050_BuildFont() at
+// scales 1 and 2, and SAA5050_PutChar() on 16 and 32 bits per pixel
+// buffers in normal and double height. Run with: make test
+
+#include <stdio.h>
+#include <string.h>
+#include "../../src/SAA5050.h"
+
+#define DIAGONAL 1              /* Alphanumeric char with a diagonal line   */
+#define GRAPHICS 96             /* The same pixels as a graphics char       */
+#define FG       0x1234CDEF     /* Foreground colour                        */
+#define BG       0x00ABCDEF     /* Background colour                        */
+
+static int Failed = 0;
+
+#define CHECK(cond, ...) \
+  do { if (!(cond)) { printf("FAIL line %d: ", __LINE__); \
+                      printf(__VA_ARGS__); putchar('\n'); ++Failed; } } while (0)
+
+static byte Font[SAA5050_FONT_SIZE];
+static byte Glyphs1[SAA5050_CHARS * SAA5050_CHAR_WIDTH * SAA5050_CHAR_HEIGHT];
+static byte Glyphs2[SAA5050_CHARS * SAA5050_CHAR_WIDTH * SAA5050_CHAR_HEIGHT * 4];
+
+/****************************************************************************/
+/*** A font that is blank but for a line from the top left, one pixel     ***/
+/*** to the right on each line, in an alphanumeric and a graphics char    ***/
+/****************************************************************************/
+static void MakeFont(void)
+{
+  int line;
+
+  memset(Font, 0, sizeof(Font));
+  for (line = 0; line < SAA5050_CHAR_WIDTH; ++line)
+  {
+    Font[DIAGONAL * SAA5050_CHAR_HEIGHT + line] = 0x20 >> line;
+    Font[GRAPHICS * SAA5050_CHAR_HEIGHT + line] = 0x20 >> line;
+  }
+}
+
+/****************************************************************************/
+/*** Return 1 if pixel (pos,line) of char c is on the diagonal            ***/
+/****************************************************************************/
+static int OnDiagonal(int c, int line, int pos)
+{
+  return (c == DIAGONAL || c == GRAPHICS) && line < SAA5050_CHAR_WIDTH && pos == line;
+}
+
+static void TestQuadrants(void)
+{
+  int line, pos, q, expect;
+
+  for (line = 0; line < SAA5050_CHAR_HEIGHT; ++line)
+    for (pos = 0; pos < SAA5050_CHAR_WIDTH; ++pos)
+    {
+      // a pixel next to a step of the diagonal is rounded towards it: the
+      // one below a step gets its top right quadrant, the one to the right
+      // of it its bottom left quadrant
+      expect = OnDiagonal(DIAGONAL, line, pos) ? SAA5050_ALL : 0;
+      if (pos + 1 == line && line < SAA5050_CHAR_WIDTH) expect = SAA5050_NE;
+      if (pos == line + 1 && pos < SAA5050_CHAR_WIDTH) expect = SAA5050_SW;
+      q = SAA5050_Quadrants(Font, DIAGONAL, line, pos);
+      CHECK(q == expect, "rounding at (%d,%d) is %d, not %d", pos, line, q, expect);
+      // graphics chars are not rounded
+      expect = OnDiagonal(GRAPHICS, line, pos) ? SAA5050_ALL : 0;
+      q = SAA5050_Quadrants(Font, GRAPHICS, line, pos);
+      CHECK(q == expect, "graphics at (%d,%d) is %d, not %d", pos, line, q, expect);
+    }
+  CHECK(SAA5050_Quadrants(Font, 0, 0, 0) == 0, "blank char is lit");
+}
+
+static void TestBuildFont(void)
+{
+  int c, x, y, lit, expect;
+
+  SAA5050_BuildFont(Font, Glyphs1, 1);
+  for (c = 0; c < SAA5050_CHARS; ++c)
+    for (y = 0; y < SAA5050_CHAR_HEIGHT; ++y)
+      for (x = 0; x < SAA5050_CHAR_WIDTH; ++x)
+      {
+        lit = Glyphs1[(c * SAA5050_CHAR_HEIGHT + y) * SAA5050_CHAR_WIDTH + x];
+        expect = OnDiagonal(c, y, x) ? 0xFF : 0x00;
+        CHECK(lit == expect, "scale 1 char %d (%d,%d) is %02X", c, x, y, lit);
+      }
+
+  // at scale 2 every quadrant is a pixel
+  SAA5050_BuildFont(Font, Glyphs2, 2);
+  for (c = 0; c < SAA5050_CHARS; ++c)
+    for (y = 0; y < 2 * SAA5050_CHAR_HEIGHT; ++y)
+      for (x = 0; x < 2 * SAA5050_CHAR_WIDTH; ++x)
+      {
+        lit = Glyphs2[(c * 2 * SAA5050_CHAR_HEIGHT + y) * 2 * SAA5050_CHAR_WIDTH + x];
+        expect = OnDiagonal(c, y / 2, x / 2) ||
+                 // top right of the pixel below a step
+                 (c == DIAGONAL && x / 2 + 1 == y / 2 && y / 2 < SAA5050_CHAR_WIDTH &&
+                  !(y & 1) && (x & 1)) ||
+                 // bottom left of the pixel right of a step
+                 (c == DIAGONAL && x / 2 == y / 2 + 1 && x / 2 < SAA5050_CHAR_WIDTH &&
+                  (y & 1) && !(x & 1)) ? 0xFF : 0x00;
+        CHECK(lit == expect, "scale 2 char %d (%d,%d) is %02X", c, x, y, lit);
+      }
+}
+
+/****************************************************************************/
+/*** Return the pixel at (x,y) of a 16 or 32 bpp buffer                   ***/
+/****************************************************************************/
+static dword Pixel(const void *buffer, int pitch, int bpp, int x, int y)
+{
+  return bpp == 16 ? ((const word *)buffer)[y * pitch + x]
+                   : ((const dword *)buffer)[y * pitch + x];
+}
+
+static void TestPutChar(void)
+{
+  // two by two cells at scale 2, with a pixel of margin on the right
+  enum { W = 2 * 2 * SAA5050_CHAR_WIDTH, H = 2 * 2 * SAA5050_CHAR_HEIGHT, PITCH = W + 1 };
+  static dword buffer[PITCH * H];
+  int bpp, si, x, y, gy, cx, cy;
+  dword fg, bg, p, expect;
+
+  for (bpp = 16; bpp <= 32; bpp += 16)
+    for (si = 0; si <= 2; ++si)
+    {
+      fg = bpp == 16 ? (word)FG : FG;
+      bg = bpp == 16 ? (word)BG : BG;
+      memset(buffer, 0x5A, sizeof(buffer));
+      SAA5050_PutChar(buffer, PITCH, bpp, Glyphs2, 2, 1, 1, DIAGONAL, fg, bg, si);
+      for (y = 0; y < H; ++y)
+        for (x = 0; x < PITCH; ++x)
+        {
+          p = Pixel(buffer, PITCH, bpp, x, y);
+          cx = x - 2 * SAA5050_CHAR_WIDTH;
+          cy = y - 2 * SAA5050_CHAR_HEIGHT;
+          if (cx < 0 || cy < 0 || x == W)
+          {
+            // outside cell (1,1) nothing is drawn
+            expect = bpp == 16 ? 0x5A5A : 0x5A5A5A5A;
+            CHECK(p == expect, "%d bpp si %d (%d,%d) drawn outside the cell", bpp, si, x, y);
+            continue;
+          }
+          // double height takes each line of one half of the glyph twice
+          gy = si ? (si - 1) * SAA5050_CHAR_HEIGHT + cy / 2 : cy;
+          expect = Glyphs2[(DIAGONAL * 2 * SAA5050_CHAR_HEIGHT + gy) * 2 * SAA5050_CHAR_WIDTH + cx] ? fg : bg;
+          CHECK(p == expect, "%d bpp si %d (%d,%d) is %X, not %X", bpp, si, cx, cy, p, expect);
+        }
+    }
+}
+
+int main(void)
+{
+  MakeFont();
+  TestQuadrants();
+  TestBuildFont();
+  TestPutChar();
+  if (Failed)
+    printf("%d check%s failed\n", Failed, Failed == 1 ? "" : "s");
+  else
+    puts("SAA5050 tests passed");
+  return Failed != 0;
+}